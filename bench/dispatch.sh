@@ -0,0 +1,75 @@
+#!/bin/sh
+# Cost per instruction of the switch and the threaded dispatch on the loops of
+# test/statements, and the wall time against the interpreter that was there 
+# before them. BASE is the commit of that interpreter, by default the one 
+# before this script was added. Its instructions are not counted and it has
+# none of the later optimizations, so that column is the gain of the whole VM,
+# not only of the dispatch. Usage: bench/dispatch.sh [CC]
+CC=${1:-${CC:-clang++}}
+RUNS=${RUNS:-5}
+BENCH=$(cd "$(dirname "$0")" && pwd)
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+
+cd "$BENCH/../src" || exit 1
+
+TOP="$BENCH/.."
+BASE=${BASE:-$(git -C "$TOP" log --diff-filter=A --format=%H \
+               -- bench/dispatch.sh 2>/dev/null | tail -1)^}
+
+build() {
+    make CC="$CC" DISPATCH="$1" > /dev/null || exit 1
+    mv cobalu "$TMP/$2"
+}
+
+build "-DCOUNT_DISPATCH" count
+build "-DSWITCH_DISPATCH" switch
+build "" threaded
+
+# Without git there is no old interpreter to build
+if git -C "$TOP" rev-parse -q --verify "$BASE^{commit}" > /dev/null; then
+    git -C "$TOP" archive "$BASE" src | tar -x -C "$TMP"
+    (cd "$TMP/src" && make CC="$CC" > /dev/null 2>&1) && \
+        mv "$TMP/src/cobalu" "$TMP/base"
+fi
+
+# Best wall time of RUNS executions in nanoseconds
+best() {
+    min=0
+    i=0
+    while [ $i -lt "$RUNS" ]; do
+        start=$(date +%s%N)
+        "$TMP/$1" "$2" > /dev/null
+        end=$(date +%s%N)
+        t=$((end - start))
+        if [ $min -eq 0 ] || [ $t -lt $min ]; then
+            min=$t
+        fi
+        i=$((i + 1))
+    done
+    echo $min
+}
+
+printf "%-10s %12s %12s %12s %8s\n" program dispatches "switch ns/i" \
+    "thread ns/i" speedup
+for prog in while for break; do
+    n=$("$TMP/count" "$BENCH/$prog" 2>&1 >/dev/null | sed -n 's/dispatches: //p')
+    s=$(best switch "$BENCH/$prog")
+    t=$(best threaded "$BENCH/$prog")
+    echo "$prog $n $s $t" | awk '{ printf "%-10s %12d %12.2f %12.2f %7.2fx\n",
+        $1, $2, $3 / $2, $4 / $2, $3 / $4 }'
+done
+
+if [ ! -x "$TMP/base" ]; then
+    echo "no interpreter of $BASE to compare"
+    exit 0
+fi
+
+echo
+printf "%-10s %12s %12s %8s\n" program "base ms" "thread ms" speedup
+for prog in while for break; do
+    b=$(best base "$BENCH/$prog")
+    t=$(best threaded "$BENCH/$prog")
+    echo "$prog $b $t" | awk '{ printf "%-10s %12.1f %12.1f %7.2fx\n",
+        $1, $2 / 1000000, $3 / 1000000, $2 / $3 }'
+done
@@ -0,0 +1,38 @@
+#!/bin/sh
+# Speed of the lexer in MB/s on a big program made of the tests and the other
+# programs of bench. Usage: bench/lexer.sh [CC]
+CC=${1:-${CC:-clang++}}
+RUNS=${RUNS:-5}
+SIZE=${SIZE:-32} # MB of source, at least
+BENCH=$(cd "$(dirname "$0")" && pwd)
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+
+cd "$BENCH/../src" || exit 1
+
+make CC="$CC" > /dev/null || exit 1
+mv cobalu "$TMP/cobalu"
+
+# Doubles the programs until the source has SIZE MB
+cat "$BENCH"/../test/*/* "$BENCH"/while "$BENCH"/for "$BENCH"/break \
+    "$BENCH"/calls > "$TMP/source"
+while [ $(wc -c < "$TMP/source") -lt $((SIZE << 20)) ]; do
+    cat "$TMP/source" "$TMP/source" > "$TMP/double"
+    mv "$TMP/double" "$TMP/source"
+done
+
+# Best speed of RUNS executions
+best=0
+i=0
+while [ $i -lt "$RUNS" ]; do
+    s=$("$TMP/cobalu" --lex "$TMP/source" 2>&1 >/dev/null |
+        sed -n 's/.*, \([0-9.]*\) MB\/s/\1/p')
+    best=$(echo "$s $best" | awk '{ print ($1 > $2) ? $1 : $2 }')
+    i=$((i + 1))
+done
+
+tokens=$("$TMP/cobalu" --lex "$TMP/source" 2>&1 >/dev/null |
+    sed -n 's/tokens: //p')
+echo "$(wc -c < "$TMP/source") $tokens $best" | awk '{ printf \
+    "%-10s %12s %12s %10s\n%-10.2f %12d %12d %10.1f\n", "MB", "tokens", \
+    "tokens/s", "MB/s", $1 / 1048576, $2, $2 * $3 * 1048576 / $1, $3 }'
@@ -0,0 +1,53 @@
+#!/bin/sh
+# Stack machine against register machine on the programs of bench. The
+# loops of while, for and break are mostly superinstructions on the stack
+# machine and run about the same number of dispatches on both, the gain is
+# on the calls and on expressions like the ones of expr.
+# Usage: bench/register.sh [CC]
+CC=${1:-${CC:-clang++}}
+RUNS=${RUNS:-5}
+BENCH=$(cd "$(dirname "$0")" && pwd)
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+
+cd "$BENCH/../src" || exit 1
+
+build() {
+    make CC="$CC" DISPATCH="$1" > /dev/null || exit 1
+    mv cobalu "$TMP/$2"
+}
+
+build "-DCOUNT_DISPATCH" count
+build "" cobalu
+
+# Best wall time of RUNS executions in milliseconds
+best() {
+    min=0
+    i=0
+    while [ $i -lt "$RUNS" ]; do
+        start=$(date +%s%N)
+        "$TMP/cobalu" $1 > /dev/null
+        end=$(date +%s%N)
+        t=$(((end - start) / 1000000))
+        if [ $min -eq 0 ] || [ $t -lt $min ]; then
+            min=$t
+        fi
+        i=$((i + 1))
+    done
+    echo $min
+}
+
+dispatches() {
+    "$TMP/count" $1 2>&1 >/dev/null | sed -n 's/dispatches: //p'
+}
+
+printf "%-10s %12s %12s %10s %10s %8s\n" program "stack disp" "reg disp" \
+    "stack ms" "reg ms" speedup
+for prog in while for break calls expr; do
+    ns=$(dispatches "$BENCH/$prog")
+    nr=$(dispatches "--register $BENCH/$prog")
+    s=$(best "$BENCH/$prog")
+    r=$(best "--register $BENCH/$prog")
+    echo "$prog $ns $nr $s $r" | awk '{ printf "%-10s %12d %12d %10d %10d %7.2fx\n",
+        $1, $2, $3, $4, $5, $4 / $5 }'
+done
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////
+/////////                            ARENA                            /////////
+///////////////////////////////////////////////////////////////////////////////
+
+// Bump allocator for the AST of the program. The objects are carved from big
+// chunks, one after the other, and all the chunks are freed at once when the
+// compilation ends. Nothing is freed alone before that.
+// The objects made by New() that have a destructor run it on the release,
+// the nodes of the AST are destroyed by their owners and only their memory
+// comes from here
+class Arena {
+    static const size_t ChunkSize = 64 << 10;
+
+    std::vector<char*> Chunks;
+    char* Next = nullptr;
+    char* Limit = nullptr;
+
+    // Destructors of the objects made by New(), run on the release
+    std::vector<std::pair<void*, void (*)(void*)>> Cleanups;
+
+    public:
+        Arena() = default;
+        Arena(const Arena&) = delete;
+        Arena& operator=(const Arena&) = delete;
+        ~Arena() { Release(); }
+
+        void* Allocate(size_t Size, size_t Align = alignof(std::max_align_t)) {
+            char* Start = (char*)(((uintptr_t)Next + Align - 1) & ~(Align - 1));
+            if (!Next || Start + Size > Limit) {
+                Start = Grow(Size + Align);
+                Start = (char*)(((uintptr_t)Start + Align - 1) & ~(Align - 1));
+            }
+            Next = Start + Size;
+            return Start;
+        }
+
+        template <typename T, typename... Args>
+        T* New(Args&&... args) {
+            T* Object = new (Allocate(sizeof(T), alignof(T)))
+                T(std::forward<Args>(args)...);
+            if constexpr (!std::is_trivially_destructible_v<T>) {
+                Cleanups.push_back({Object, [](void* Ptr) {
+                    ((T*)Ptr)->~T();
+                }});
+            }
+            return Object;
+        }
+
+        void Release();
+
+    private:
+        char* Grow(size_t Size);
+};
+
+// Owns the AST and the blocks of the program being compiled
+extern Arena AstArena;
@@ -1,5 +1,12 @@
 #include "global.h"
 
+// Place where a variable is stored. Globals are indexes in the table of 
+// globals and locals are indexes in the frame of the function
+struct VarSlot {
+    int Index;
+    bool Global;
+};
+
 // All the program is wrapper by thin layer of Block
 class BlockAST {
     // Variable that stores the state of the block
@@ -7,22 +14,74 @@ class BlockAST {
     
     // It's possible to have nested blocks, and each block has it's own 
     // variable map. 
-    std::shared_ptr<BlockAST> ParentBlock;
+    BlockAST* ParentBlock;
+
+    // Only the global block and the block of functions own a frame, the 
+    // variables of nested blocks are stored in the frame of its owner
+    bool Frame;
+    int FrameSize;
 
-    // This will be a map that stores the offset of variables
-    std::unordered_map<std::string, int> VarMap;
+    // Blocks are numbered in the order they are parsed, the blocks inside
+    // this one have the numbers from Id to Last
+    int Id;
+    int Last;
 
-    // This will be a map that stores the offset of functions
-    std::unordered_map<std::string, int> FuncMap;
+    BlockAST* FrameOwner();
 
     public:
-        BlockAST(std::shared_ptr<BlockAST> ParentBlock ,int State) 
-            : State(State), ParentBlock(ParentBlock)  {}
+        BlockAST(BlockAST* ParentBlock ,int State);
 
-         int varGetOffset(std::string);
-         int varSetOffset(std::string);
-         int funcSetOffset(std::string);
-         int funcGetOffset(std::string);
+         VarSlot varGetOffset(StrObj*);
+         VarSlot varSetOffset(StrObj*);
+         void funcSetOffset(StrObj*, int);
+         int funcGetOffset(StrObj*);
          void ChangeState(int);
          int ReturnState();
+         void OwnFrame();
+         int SlotsUsed();
+         BlockAST* Parent() { return ParentBlock; }
+
+         // If the block is this one or is inside it
+         bool Encloses(const BlockAST* Block) const {
+             return Id <= Block->Id && Block->Id <= Last;
+         }
+};
+
+// Names declared in the blocks, in flat tables indexed by the symbol of the
+// name instead of a map in each block. The table of a symbol is only made
+// when it is declared.
+// The code is resolved in order, so a name refers to the last declaration
+// made in a block around the place where it is used: a block is left before
+// the blocks around it declare something else. Looking for it from the end
+// finds it after the few later declarations in other blocks, no matter how
+// deep the block is
+template <typename T>
+class ScopeTable {
+    struct Binding {
+        const BlockAST* Block;
+        T Value;
+    };
+    std::vector<std::vector<Binding>> Bindings;
+
+    public:
+        void Set(const BlockAST* Block, StrObj* Name, T Value) {
+            if (Name->Symbol >= Bindings.size()) {
+                Bindings.resize(Name->Symbol + 1);
+            }
+            Bindings[Name->Symbol].push_back({Block, Value});
+        }
+
+        // Declaration seen from the block, nullptr if there is none
+        T* Get(const BlockAST* Block, StrObj* Name) {
+            if (Name->Symbol >= Bindings.size()) {
+                return nullptr;
+            }
+            std::vector<Binding>& Found = Bindings[Name->Symbol];
+            for (auto Bind = Found.rbegin(); Bind != Found.rend(); Bind++) {
+                if (Bind->Block->Encloses(Block)) {
+                    return &Bind->Value;
+                }
+            }
+            return nullptr;
+        }
 };
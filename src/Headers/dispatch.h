@@ -0,0 +1,27 @@
+#pragma once
+
+// The dispatch is direct threaded when the compiler has labels as values 
+// (GCC and Clang), every handler jumps straight to the handler of the next
+// instruction. Otherwise, or when built with SWITCH_DISPATCH, it falls back to
+// a portable loop around a switch.
+// The loops that use it keep the instructions in "code", the current one in
+// "sp" and, when threaded, the handlers in "labels".
+#if defined(__GNUC__) && !defined(SWITCH_DISPATCH)
+#define THREADED_DISPATCH
+#endif
+
+#ifdef COUNT_DISPATCH
+extern long long Dispatches;
+#define COUNT() Dispatches++
+#else
+#define COUNT()
+#endif
+
+#ifdef THREADED_DISPATCH
+#define CASE(inst) L_##inst:
+#define DISPATCH() COUNT(); goto *labels[code[sp].inst]
+#else
+#define CASE(inst) case inst:
+#define DISPATCH() COUNT(); continue
+#endif
+#define NEXT() sp++; DISPATCH()
@@ -6,12 +6,15 @@ class Logging {
         std::string Error;
         int Level;
         int Line;
+        int Column;
     };
 
     // Stack of Errors
     std::vector<Log> StackError;
 
-    int LineNumber;
+    // Position of the token being parsed
+    int Line = 1;
+    int Column = 1;
 
 public:
     // Log for Errors. This happen during the execution
@@ -21,7 +24,8 @@ public:
     void ShowErrors();
     void PushError(std::string, std::string, int);
     int NumErrors();
-    void AddLine();
+    int NumParseErrors();
+    void SetPosition(int Line, int Column);
 };
 
 extern Logging ErLogs;
\ No newline at end of file
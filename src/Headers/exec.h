@@ -1,22 +1,50 @@
 #include "global.h"
 
-enum ValueType {
-    doub,
-    boo,
-    str,
-    nil,
+// Going over one of the limits of the VM stops the execution
+void LimitError(std::string, long);
+
+// Operations on values, shared by the stack and the register machine. They
+// return 0 when the operation is not permited, after reporting it
+int AddValues(const Value&, const Value&, Value&);
+int SubValues(const Value&, const Value&, Value&);
+int MulValues(const Value&, const Value&, Value&);
+int DivValues(const Value&, const Value&, Value&);
+int EqValues(const Value&, const Value&, Value&);
+int IneqValues(const Value&, const Value&, Value&);
+int GrValues(const Value&, const Value&, Value&);
+int LsValues(const Value&, const Value&, Value&);
+int GreqValues(const Value&, const Value&, Value&);
+int LseqValues(const Value&, const Value&, Value&);
+int NegValue(const Value&, Value&);
+int InvsigValue(const Value&, Value&);
+void PrintValue(const Value&);
+int FalseValue(const Value&); // 1 if the condition fails
+
+// Record of a function being executed
+struct CallFrame {
+    int Return; // instruction after the callfunc
+    int Base; // base of the frame of the caller
 };
 
 // Definition of the class 
 class Calculus {
     std::vector<Value> Calc;
 
+    // Storage of variables
+    std::vector<Value> Globals;
+    std::vector<Value> Locals; // frames of all the functions being executed
+    int Base = 0; // first local of the current frame
+
+    // Stack of calls
+    std::vector<CallFrame> Frames;
+
     public:
         // Verify the Stack
-        int EmptyStack();    
+        int EmptyStack(size_t Operands = 1);    
 
         // Operations on stack
         void PushCalc(Value);
+        void popData();
 
         // Binary Operations on Doubles
         // Arithmetic 
@@ -32,23 +60,60 @@ class Calculus {
         void greqData();
         void lseqData();
 
+        // Quickened operations, for the types they were specialized to. If
+        // the guard fails they return 0 and leave the stack untouched
+        template <typename Operation>
+        int numData(Operation op) {
+            size_t size = Calc.size();
+            if (size < 2 || !Calc[size - 2].IsDouble() || 
+                !Calc[size - 1].IsDouble()) {
+                return 0;
+            }
+            Calc[size - 2] = op(Calc[size - 2].AsDouble(), 
+                                Calc[size - 1].AsDouble());
+            Calc.pop_back();
+            return 1;
+        }
+        int addstrData();
+        int eqstrData(bool);
+
+        // Typed operations, the operands are known to be doubles
+        template <typename Operation>
+        void typedData(Operation op) {
+            size_t size = Calc.size();
+            Calc[size - 2] = op(Calc[size - 2].AsDouble(), 
+                                Calc[size - 1].AsDouble());
+            Calc.pop_back();
+        }
+
+        // Operands on the top of the stack, null if there are not enough
+        const Value* Peek(size_t depth) {
+            return depth < Calc.size() ? &Calc[Calc.size() - 1 - depth] 
+                                       : nullptr;
+        }
+
         // Unary Operations on Doubles
         void negData();
         void invsigData();
         
         // Variable
+        void InitGlobals(int);
         void stvarData(int);
         void retvarData(int);
+        void stglobData(int);
+        void retglobData(int);
+        Value& Global(int slot) { return Globals[slot]; }
+        Value& Local(int slot) { return Locals[Base + slot]; }
 
         // Built-in
         void printData(); // print
 
         // Condition
-        void evalCondition();
+        int evalCondition();
 
         // Function
-        void funcGen(int);
-        void callFunc(int);
-        void retfuncData(int);
+        int callFunc(int, int);
+        int retfuncData();
+        int tailFunc(int);
 };
     
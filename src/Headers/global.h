@@ -1,21 +1,42 @@
+#pragma once
+
 // Definition of all librarys
 #include <algorithm>
 #include <cctype>
+#include <climits>
+#include <cstdint>
 #include <cstdlib>
 #include <cstring>
 #include <fstream>
 #include <iostream>
 #include <iomanip>
+#include <map>
 #include <memory>
 #include <string> 
 #include <unordered_map>
-#include <variant>
 #include <vector>
 
 // Define "union"
-typedef std::variant<double, bool, std::string, int*> Value ;
+#include "value.h"
+
+// Options given in the command line
+struct Options {
+    // Limits of the VM, going over them stops the execution with a error
+    long StackLimit = 1 << 20; // values on the stack of execution
+    long CallLimit = 1 << 16; // functions being executed at the same time
+    long HeapLimit = 1 << 28; // bytes of strings created during execution
+    long InlineSize = 32; // nodes of the largest function inlined at its calls
+
+    bool Register = false; // run on the register machine instead of the stack
+    bool Profile = false; // report the hottest sequences of instructions
+    bool Fuse = true; // replace common sequences by superinstructions
+    bool Optimize = true; // optimize the program before and after codegen
+    bool ShowDead = false; // print the code removed as dead
+    bool Ssa = false; // compile the stack code through the SSA form
+    bool Lex = false; // only tokenize the file and report the speed of it
+};
 
-extern std::fstream FileInput;
+extern Options CobaluOpts;
 
 // Definition for DEBUGs
 //#define DEBUG
@@ -3,11 +3,25 @@
 // First stage of the parser TOKENS!!!
 int Tokenizer();
 
-// Buffers.
-// Used to save the current value of a constant
-extern std::string Identifier;
-extern std::string StringBuffer; 
-extern double DoubleBuffer;
+// Source read by the tokenizer, it must live until the parsing ends
+void LexerInput(const char* Begin, const char* End);
+
+// Token as a span of the source, its text is read from there and only
+// copied when it is interned or converted to a number
+struct Span {
+    int Kind = 0;
+    long Offset = 0; // from the start of the source
+    long Length = 0;
+    int Line = 1;
+    int Column = 1;
+    StrObj* Symbol = nullptr; // name of a identifier, interned by the lexer
+};
+
+// Last token read, its text and the value of a number
+extern Span TokenSpan;
+std::string_view TokenText(); // a string without the quotes
+double TokenNumber();
+StrObj* TokenName(); // the text interned
 
 enum Token {
     // The following will be treated as literals
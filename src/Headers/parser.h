@@ -1,4 +1,5 @@
 #include "global.h"
+#include "arena.h"
 #include "block.h"
 #include <clocale>
 #include <memory>
@@ -18,12 +19,84 @@ enum BlockState {
 /////////                           AST CLASS                         /////////
 ///////////////////////////////////////////////////////////////////////////////
 
+class DeclarationAST;
+
+// Static type of a expression whose type is not known before running it
+const int UNTYPED = -1;
+// Type of a value while the values it comes from are still being looked at
+const int UNRESOLVED = -2;
+
+// What the optimizer knows of a variable: the places that store on it and,
+// if the declaration stores a literal, its value
+struct VarInfo {
+    int Stores = 0;
+    bool Known = false;
+    Value Literal;
+
+    StrObj* Owner = nullptr; // function of its frame, nullptr if global
+    bool Escapes = false; // stored by a function other than its owner
+    bool Shared = false; // read or stored by a function other than its owner
+
+    // Values stored on it, nullptr if it is unknown, and the type all of them
+    // have
+    std::vector<DeclarationAST*> Sources;
+    int Type = UNTYPED;
+};
+
 // Declarations are the top of the grammar, everything falls in a declaration
 class DeclarationAST {
     public:
         DeclarationAST() = default;
         virtual ~DeclarationAST() = default;
+
+        // The nodes live in the arena of the AST. Deleting one only runs its
+        // destructor, the memory goes back when the arena is released
+        static void* operator new(size_t Size) {
+            return AstArena.Allocate(Size);
+        }
+        static void operator delete(void*) {}
+
         virtual void codegen() = 0;
+        // Jumps of a condition taken when it is true, or false, the code 
+        // falls through otherwise. Adds where they are to set them later
+        virtual void branch(bool, std::vector<int>&);
+
+        // Code generation for the register machine, returns the operand
+        // where the value of a expression is
+        virtual int regcodegen() = 0;
+        // Jumps of a condition, like branch()
+        virtual void regbranch(bool, std::vector<int>&);
+        // Construction of the SSA form, returns the value of a expression
+        virtual int irgen() = 0;
+        // Condition that goes to the first block if it holds, to the second
+        // otherwise
+        virtual void irbranch(int, int);
+        // If it can change variables while evaluated
+        virtual bool HasEffects() { return true; }
+
+        // Optimization pass, between the parser and the code generation.
+        // resolve() finds the variable of each name and counts its stores,
+        // optimize() folds the constants and returns the node that replaces
+        // this one, or nullptr to keep it
+        virtual void resolve() {}
+        virtual std::unique_ptr<DeclarationAST> optimize() { return nullptr; }
+        // Value of the node if it is a literal
+        virtual bool Literal(Value&) { return false; }
+        // If the statement never lets the execution reach the next one
+        virtual bool Terminates() { return false; }
+
+        // Places of the nodes under this one, for the passes that handle all
+        // the kinds of nodes alike
+        virtual void children(std::vector<std::unique_ptr<DeclarationAST>*>&) 
+        {}
+        // Type of the value if it is known before running, UNTYPED otherwise.
+        // A expression of known type can't fail
+        virtual int StaticType();
+        // Moves the computations that don't change out of a loop
+        virtual void hoist() {}
+        // Copy of the node for the body of a inlined function, nullptr if it
+        // can't be moved to the place of the call
+        virtual std::unique_ptr<DeclarationAST> clone() { return nullptr; }
 };
 
 // Statements are the second class. Consider that every line will be a 
@@ -46,14 +119,24 @@ class DoubleAST : public ExpressionAST {
         DoubleAST(double DoubleValue) : DoubleValue(DoubleValue) {}
         
         void codegen() override;
+        int regcodegen() override;
+        int irgen() override;
+        std::unique_ptr<DeclarationAST> clone() override;
+        bool HasEffects() override { return false; }
+        bool Literal(Value&) override;
 };
 
 class StringAST : public ExpressionAST {
-    std::string StringValue;
+    StrObj* StringValue; // interned
     public:
-        StringAST(std::string StringValue) : StringValue(StringValue) {}
+        StringAST(StrObj* StringValue) : StringValue(StringValue) {}
 
         void codegen() override;
+        int regcodegen() override;
+        int irgen() override;
+        std::unique_ptr<DeclarationAST> clone() override;
+        bool HasEffects() override { return false; }
+        bool Literal(Value&) override;
 };
 
 class BoolAST : public ExpressionAST {
@@ -62,6 +145,11 @@ class BoolAST : public ExpressionAST {
         BoolAST(bool BoolValue) : BoolValue(BoolValue) {}
 
         void codegen() override;
+        int regcodegen() override;
+        int irgen() override;
+        std::unique_ptr<DeclarationAST> clone() override;
+        bool HasEffects() override { return false; }
+        bool Literal(Value&) override;
 };
 
 class NullAST : public ExpressionAST {
@@ -69,6 +157,11 @@ class NullAST : public ExpressionAST {
         NullAST() {}
 
         void codegen() override;
+        int regcodegen() override;
+        int irgen() override;
+        std::unique_ptr<DeclarationAST> clone() override;
+        bool HasEffects() override { return false; }
+        bool Literal(Value&) override;
 };
 
 // Define Binary operation
@@ -84,6 +177,19 @@ class OperationAST : public ExpressionAST {
         : LHS(std::move(LHS)), RHS(std::move(RHS)), Op(Op) {}
     
         void codegen() override;
+        int regcodegen() override;
+        int irgen() override;
+        std::unique_ptr<DeclarationAST> clone() override;
+        void resolve() override;
+        std::unique_ptr<DeclarationAST> optimize() override;
+        void branch(bool, std::vector<int>&) override;
+        void regbranch(bool, std::vector<int>&) override;
+        void irbranch(int, int) override;
+        bool HasEffects() override {
+            return LHS->HasEffects() || RHS->HasEffects();
+        }
+        void children(std::vector<std::unique_ptr<DeclarationAST>*>&) override;
+        int StaticType() override;
 };
 
 // Define Unary operation
@@ -96,6 +202,14 @@ class UnaryAST : public ExpressionAST {
             : Expr(std::move(Expr)), Op(Op) {}
 
         void codegen() override;
+        int regcodegen() override;
+        int irgen() override;
+        std::unique_ptr<DeclarationAST> clone() override;
+        void resolve() override;
+        std::unique_ptr<DeclarationAST> optimize() override;
+        bool HasEffects() override { return Expr->HasEffects(); }
+        void children(std::vector<std::unique_ptr<DeclarationAST>*>&) override;
+        int StaticType() override;
 };
 
 // Built-in Function
@@ -107,35 +221,66 @@ class PrintAST : public StatementAST {
             : Expr(std::move(Expr)) {}
         
         void codegen() override;
+        int regcodegen() override;
+        int irgen() override;
+        std::unique_ptr<DeclarationAST> clone() override;
+        void resolve() override;
+        std::unique_ptr<DeclarationAST> optimize() override;
+        void children(std::vector<std::unique_ptr<DeclarationAST>*>&) override;
 };
 
 // Variable declaration
 class VarDeclAST : public StatementAST {
     std::unique_ptr<DeclarationAST> Expr;
-    std::shared_ptr<BlockAST> ParentBlock;
-    std::string Variable;
+    BlockAST* ParentBlock;
+    StrObj* Variable;
     int Decl;
+    VarInfo* Info = nullptr;
 
     public:
-        VarDeclAST(std::string Variable, int Decl, 
+        VarDeclAST(StrObj* Variable, int Decl, 
                    std::unique_ptr<DeclarationAST> Expr, 
-                   std::shared_ptr<BlockAST> ParentBlock) 
+                   BlockAST* ParentBlock) 
             : Expr(std::move(Expr)), ParentBlock(ParentBlock),
               Variable(Variable), Decl(Decl) {}
     
         void codegen() override;
+        int regcodegen() override;
+        int irgen() override;
+        std::unique_ptr<DeclarationAST> clone() override;
+        void resolve() override;
+        std::unique_ptr<DeclarationAST> optimize() override;
+        void children(std::vector<std::unique_ptr<DeclarationAST>*>&) override;
+
+        VarInfo* GetInfo() { return Info; }
+        void SetInfo(VarInfo* Var) { Info = Var; }
+        DeclarationAST* Stored() { return Expr.get(); }
+        StrObj* Name() { return Variable; }
+        bool Declares() { return Decl == 1; }
 };
 
 // Variable value
-class VarValAST : public StatementAST {
-    std::shared_ptr<BlockAST> ParentBlock;
-    std::string Variable;
+class VarValAST : public ExpressionAST {
+    BlockAST* ParentBlock;
+    StrObj* Variable;
+    VarInfo* Info = nullptr;
 
     public:
-        VarValAST(std::string Variable, std::shared_ptr<BlockAST> ParentBlock)
+        VarValAST(StrObj* Variable, BlockAST* ParentBlock)
             : ParentBlock(ParentBlock), Variable(Variable) {}
         
         void codegen() override;
+        int regcodegen() override;
+        int irgen() override;
+        std::unique_ptr<DeclarationAST> clone() override;
+        void resolve() override;
+        std::unique_ptr<DeclarationAST> optimize() override;
+        bool HasEffects() override { return false; }
+        int StaticType() override { return Info ? Info->Type : UNTYPED; }
+
+        VarInfo* GetInfo() { return Info; }
+        void SetInfo(VarInfo* Var) { Info = Var; }
+        StrObj* Name() { return Variable; }
 };
 
 // Struct to implement inside the block
@@ -149,6 +294,13 @@ class InsideAST : public StatementAST {
             : Chain(std::move(Chain)), Exec(std::move(Exec)) {}
         
         void codegen() override;
+        int regcodegen() override;
+        int irgen() override;
+        std::unique_ptr<DeclarationAST> clone() override;
+        void resolve() override;
+        std::unique_ptr<DeclarationAST> optimize() override;
+        bool Terminates() override;
+        void children(std::vector<std::unique_ptr<DeclarationAST>*>&) override;
 };
 
 class IfAST : public StatementAST {
@@ -164,18 +316,38 @@ class IfAST : public StatementAST {
         ElseBlock(std::move(ElseBlock)) {}
 
         void codegen() override;
+        int regcodegen() override;
+        int irgen() override;
+        std::unique_ptr<DeclarationAST> clone() override;
+        void resolve() override;
+        std::unique_ptr<DeclarationAST> optimize() override;
+        bool Terminates() override;
+        void children(std::vector<std::unique_ptr<DeclarationAST>*>&) override;
 };
 
+// The preheader of a loop runs once before it, it stores the computations
+// hoisted out of the loop
 class WhileAST : public StatementAST {
     std::unique_ptr<DeclarationAST> Cond;
     std::unique_ptr<DeclarationAST> Loop;
+    std::vector<std::unique_ptr<DeclarationAST>> Preheader;
+    BlockAST* ParentBlock;
 
     public:
         WhileAST(std::unique_ptr<DeclarationAST> Cond,
-                std::unique_ptr<DeclarationAST> Loop)
-        : Cond(std::move(Cond)), Loop(std::move(Loop)) {}
+                std::unique_ptr<DeclarationAST> Loop,
+                BlockAST* ParentBlock)
+        : Cond(std::move(Cond)), Loop(std::move(Loop)), 
+          ParentBlock(ParentBlock) {}
 
         void codegen() override;
+        int regcodegen() override;
+        int irgen() override;
+        std::unique_ptr<DeclarationAST> clone() override;
+        void resolve() override;
+        std::unique_ptr<DeclarationAST> optimize() override;
+        void children(std::vector<std::unique_ptr<DeclarationAST>*>&) override;
+        void hoist() override;
 };
 
 class ForAST : public StatementAST {
@@ -183,17 +355,27 @@ class ForAST : public StatementAST {
         std::unique_ptr<DeclarationAST> Cond;
         std::unique_ptr<DeclarationAST> Iterator;
         std::unique_ptr<DeclarationAST> Loop;
+        std::vector<std::unique_ptr<DeclarationAST>> Preheader;
+        BlockAST* ParentBlock;
 
         public:
             ForAST(std::unique_ptr<DeclarationAST> Var,
                    std::unique_ptr<DeclarationAST> Cond,
                    std::unique_ptr<DeclarationAST> Iterator,
-                   std::unique_ptr<DeclarationAST> Loop)
+                   std::unique_ptr<DeclarationAST> Loop,
+                   BlockAST* ParentBlock)
                 : Var(std::move(Var)), Cond(std::move(Cond)),
                   Iterator(std::move(Iterator)),
-                  Loop(std::move(Loop)) {}
+                  Loop(std::move(Loop)), ParentBlock(ParentBlock) {}
 
         void codegen() override;
+        int regcodegen() override;
+        int irgen() override;
+        std::unique_ptr<DeclarationAST> clone() override;
+        void resolve() override;
+        std::unique_ptr<DeclarationAST> optimize() override;
+        void children(std::vector<std::unique_ptr<DeclarationAST>*>&) override;
+        void hoist() override;
 };
 
 class BreakAST : public StatementAST {
@@ -201,22 +383,27 @@ class BreakAST : public StatementAST {
         BreakAST() {}
 
         void codegen() override;
+        int regcodegen() override;
+        int irgen() override;
+        std::unique_ptr<DeclarationAST> clone() override;
+        bool Terminates() override { return true; }
 };
 
 
 class FunctionAST : public DeclarationAST {
-    std::string Name;
-    std::vector<std::string> Var;
+    StrObj* Name;
+    std::vector<StrObj*> Var;
     std::unique_ptr<DeclarationAST> Exec;
-    std::shared_ptr<BlockAST> Env;
-    std::shared_ptr<BlockAST> ParentBlock;
+    BlockAST* Env;
+    BlockAST* ParentBlock;
+    std::vector<VarInfo*> Params; // variables of the arguments
 
     public:
-        FunctionAST(std::string Name,
-                    std::shared_ptr<BlockAST> ParentBlock)
+        FunctionAST(StrObj* Name,
+                    BlockAST* ParentBlock)
             : Name(Name), ParentBlock(ParentBlock) {}
 
-        bool SetVar(std::string PlaceHolder) {
+        bool SetVar(StrObj* PlaceHolder) {
             if(std::find(Var.begin(), Var.end(), PlaceHolder) == Var.end()) {
                 Var.push_back(PlaceHolder);
                 return true;
@@ -228,7 +415,7 @@ class FunctionAST : public DeclarationAST {
             Exec = std::move(ExecBlock);
         }
 
-        void SetEnv(std::shared_ptr<BlockAST> FuncEnv) {
+        void SetEnv(BlockAST* FuncEnv) {
             Env = FuncEnv;
         }
 
@@ -236,17 +423,34 @@ class FunctionAST : public DeclarationAST {
             return Var.size();
         }
 
+        StrObj* FuncName() {
+            return Name;
+        }
+
+        // Body of the function bound to the arguments of a call in the 
+        // block, nullptr if it can't be inlined. The arguments are only
+        // taken if it can
+        std::unique_ptr<DeclarationAST> 
+        Inline(std::vector<std::unique_ptr<DeclarationAST>>& Args,
+               BlockAST* Block);
+
         void codegen() override;
+        int regcodegen() override;
+        int irgen() override;
+        void resolve() override;
+        std::unique_ptr<DeclarationAST> optimize() override;
+        void children(std::vector<std::unique_ptr<DeclarationAST>*>&) override;
 };
 
-class CallFuncAST : public StatementAST {
-    std::string FuncName;
+class CallFuncAST : public ExpressionAST {
+    StrObj* FuncName;
     std::vector<std::unique_ptr<DeclarationAST>> VarVal;
-    std::shared_ptr<BlockAST> ParentBlock;
+    BlockAST* ParentBlock;
+    FunctionAST* Callee = nullptr; // found by the optimizer
 
     public:
-        CallFuncAST(std::string FuncName,
-                    std::shared_ptr<BlockAST> ParentBlock)
+        CallFuncAST(StrObj* FuncName,
+                    BlockAST* ParentBlock)
             : FuncName(FuncName), ParentBlock(ParentBlock) {}
 
         void SetVar(std::unique_ptr<DeclarationAST> Val) {
@@ -254,6 +458,38 @@ class CallFuncAST : public StatementAST {
         }
 
         void codegen() override;
+        int regcodegen() override;
+        int irgen() override;
+        void resolve() override;
+        std::unique_ptr<DeclarationAST> optimize() override;
+        void children(std::vector<std::unique_ptr<DeclarationAST>*>&) override;
+
+        // Generates the call. A tail call is the value returned by a 
+        // function, the function called reuses its frame and returns for it
+        void callgen(bool Tail);
+        int regcallgen(bool Tail);
+
+        StrObj* Name() { return FuncName; }
+        FunctionAST* Function() { return Callee; }
+};
+
+// Body of a function inlined at a call. The statements run and the value of
+// the result is the value of the call
+class InlineAST : public ExpressionAST {
+    std::vector<std::unique_ptr<DeclarationAST>> Body;
+    std::unique_ptr<DeclarationAST> Result;
+
+    public:
+        InlineAST(std::vector<std::unique_ptr<DeclarationAST>> Body,
+                  std::unique_ptr<DeclarationAST> Result)
+            : Body(std::move(Body)), Result(std::move(Result)) {}
+
+        void codegen() override;
+        int regcodegen() override;
+        int irgen() override;
+        std::unique_ptr<DeclarationAST> optimize() override;
+        void children(std::vector<std::unique_ptr<DeclarationAST>*>&) override;
+        std::unique_ptr<DeclarationAST> clone() override;
 };
 
 class ReturnAST : public StatementAST {
@@ -263,6 +499,12 @@ class ReturnAST : public StatementAST {
         ReturnAST(std::unique_ptr<DeclarationAST> RetVal) : RetVal(std::move(RetVal)) {}
 
         void codegen() override;
+        int regcodegen() override;
+        int irgen() override;
+        void resolve() override;
+        std::unique_ptr<DeclarationAST> optimize() override;
+        bool Terminates() override { return true; }
+        void children(std::vector<std::unique_ptr<DeclarationAST>*>&) override;
 };
 
 
@@ -270,4 +512,15 @@ class ReturnAST : public StatementAST {
 /////////                           FUNCTIONS                         /////////
 ///////////////////////////////////////////////////////////////////////////////
 
-std::unique_ptr<DeclarationAST> Parser(std::shared_ptr<BlockAST> GlobalAST);
+std::unique_ptr<DeclarationAST> Parser(BlockAST* GlobalAST);
+
+// Optimization pass on the whole program
+void Optimize(std::unique_ptr<DeclarationAST>&);
+void ResolveProgram(std::vector<std::unique_ptr<DeclarationAST>>&);
+void OptimizeProgram(std::vector<std::unique_ptr<DeclarationAST>>&);
+
+// Types of the result of the operations, shared with the SSA form
+int ResultType(int Op, int Left, int Right);
+int UnaryType(int Op, int Operand);
+// The && and the ||, that only run the right side if needed
+bool Logical(int Op);
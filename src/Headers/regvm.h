@@ -0,0 +1,125 @@
+#include "global.h"
+
+// Opcodes of the register machine. The operations read their operands and
+// write the result directly where they live, without the stack of execution
+enum RegInstruction : uint8_t {
+    // Binary: a = b op c
+    // arithmetic
+    radd,
+    rsub,
+    rmul,
+    rdiv,
+    // Comparasion
+    req,
+    rineq,
+    rgr,
+    rls,
+    rgreq,
+    rlseq,
+
+    // Unary: a = op b
+    rneg, // negate '!'
+    rinv, // invert signal '-'
+    rmove, // a = b
+
+    // Built-in Function
+    rprint, // print a
+
+    // Goto, the offset is relative to the jump
+    rjmp,
+    rjmpf, // jump if a is false
+    rjmpt, // jump if a is true
+
+    // Comparasion and jump: jump if a op b is true
+    rjeq,
+    rjineq,
+    rjgr,
+    rjls,
+    rjgreq,
+    rjlseq,
+    // jump if a op b is false
+    rjneq,
+    rjnineq,
+    rjngr,
+    rjnls,
+    rjngreq,
+    rjnlseq,
+
+    // Function
+    rcall, // call function b, the arguments start at register a and c of
+           // them are missing
+    rret, // return a
+    rtail, // rcall in the frame of the function, that returns
+    rfuncend,
+
+    rend, // End Of Stack
+};
+
+// Operands are 16 bits, the 2 high bits tell where the value lives and the
+// rest is its index there
+const uint16_t REG = 0 << 14; // register of the frame
+const uint16_t KONST = 1 << 14; // constant pool
+const uint16_t GLOB = 2 << 14; // table of globals
+const uint16_t TEMP = 3 << 14; // temporary, only while the code is generated
+const int OPERAND_INDEX = (1 << 14) - 1;
+
+// Every instruction is a word with up to three operands. Jumps keep a 24 bits
+// offset in ext and c
+struct RegBytecode {
+    RegInstruction inst;
+    int8_t ext = 0;
+    uint16_t a = 0;
+    uint16_t b = 0;
+    uint16_t c = 0;
+
+    int Jump() const { return ext * 65536 + c; }
+    void SetJump(int offset) {
+        ext = offset >> 16;
+        c = offset & 0xffff;
+    }
+};
+
+// The frame of a function starts on the registers where the caller left the
+// arguments, they are the first registers and the first one also receives
+// the returned value
+struct RegFunction {
+    int Entry; // first instruction of the body
+    int Params; // number of arguments
+    int Registers; // size of the frame
+};
+
+class RegisterStack {
+    std::vector<RegBytecode> Stack;
+    std::vector<RegFunction> Functions; // table of functions
+    int registers = 0; // size of the frame of the global code
+
+    public:
+        RegisterStack() {}
+
+        // Stack Operations
+        int Push(RegBytecode);
+        int Size();
+        RegBytecode& At(int);
+        const RegBytecode* Code();
+        void Relocate(int, int, int);
+
+        // Functions
+        int AddFunc();
+        void SetFunc(int, int, int, int);
+        const RegFunction& Func(int);
+
+        // Frame of the global code
+        void SetRegisters(int);
+        int Registers();
+};
+
+extern RegisterStack RegStack;
+
+// Number of operands of a instruction, they are its first fields
+int RegOperands(RegInstruction);
+
+// Declaration for codegeneration
+void RegCompile();
+
+// Declaration for execution of code
+void RegExec();
@@ -0,0 +1,77 @@
+// Needs parser.h included before it
+
+///////////////////////////////////////////////////////////////////////////////
+/////////                           SSA FORM                          /////////
+///////////////////////////////////////////////////////////////////////////////
+
+// The SSA form sits between the AST and the bytecode. Every value is the
+// instruction that computes it, defined once, and the variables are the
+// values they have at each point. A value that comes from more than one
+// block is merged by a phi at the start of the block.
+// The globals read or stored by a function stay in memory, they are loaded
+// and stored like in the stack code
+
+enum IrOp {
+    iconst, // the literal of the instruction, it belongs to no block
+    iparam, // argument of the function, imm is its position
+    iload, // global in memory, imm is its slot
+    istore, // args: value stored in the global of the slot imm
+    iphi, // args: the value of each predecessor of the block, in order
+    ibinary, // imm is the token of the operator, args: left and right
+    iunary, // imm is the token of the operator, args: operand
+    iprint, // args: value printed
+    icall, // imm is the index of the function, args: arguments
+
+    // Terminators, the last instruction of each block
+    ijmp, // goes to the successor
+    ibranch, // args: condition, goes to the first successor if it holds
+    iret, // args: value returned
+    iend, // end of the function or of the program
+};
+
+struct IrInst {
+    IrOp Op;
+    int Imm = 0;
+    Value Literal;
+    std::vector<int> Args;
+    int Block = -1;
+    int Type = UNTYPED;
+    bool Dead = false;
+};
+
+struct IrBlock {
+    std::vector<int> Phis;
+    std::vector<int> Insts; // the terminator is the last one
+    std::vector<int> Preds;
+    std::vector<int> Succs; // the true one goes first on a branch
+    bool Sealed = false; // all the predecessors are known
+    bool Reachable = true;
+};
+
+struct IrFunction {
+    int Index = -1; // in the table of functions, -1 for the global code
+    int Params = 0;
+    std::vector<IrInst> Values;
+    std::vector<IrBlock> Blocks; // the first one is the entry
+    std::vector<int> Layout; // order of the blocks in the code
+
+    // Construction: value of each variable at the end of each block, and
+    // phis of blocks not sealed yet, that get their arguments when sealed
+    std::unordered_map<VarInfo*, std::unordered_map<int, int>> Defs;
+    std::unordered_map<int, std::vector<std::pair<VarInfo*, int>>> Incomplete;
+};
+
+// Functions of the program, built by the irgen() of their declaration
+extern std::vector<std::unique_ptr<IrFunction>> IrFunctions;
+// Slots of the globals in memory
+extern int IrShared;
+
+void IrStart(IrFunction*);
+int IrEmit(IrOp, std::vector<int> Args = {}, int Imm = 0);
+
+// Passes on the SSA form and its translation to the stack code
+void SsaOptimize(IrFunction&);
+int SsaLower(IrFunction&, int Base); // returns the slots used
+#ifdef DEBUG
+void SsaDump(IrFunction&);
+#endif
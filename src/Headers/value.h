@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+// Types of the values
+enum ValueType {
+    doub,
+    boo,
+    str,
+    nil,
+};
+
+// Strings are immutable objects on the heap, values only point to them. The
+// hash and the length are computed once, when the string is created. 
+// Literals and identifiers are interned: there is only one object for each
+// text and it lives as long as the program. Each one gets a symbol, a small
+// number that indexes the tables of the compiler
+struct StrObj {
+    uint32_t RefCount;
+    uint32_t Hash;
+    uint32_t Length;
+    uint32_t Symbol; // from 1 in the order they are interned, 0 if not
+    char Text[]; // ends with '\0'
+
+    std::string_view View() const { return {Text, Length}; }
+};
+
+// Heap of strings
+StrObj* Intern(std::string_view);
+StrObj* ConcatString(const StrObj*, const StrObj*);
+bool EqualStrings(const StrObj*, const StrObj*);
+void FreeString(StrObj*);
+long HeapSize();
+
+// Values are NaN-boxed in 64 bits. A double is stored as it is, the other 
+// types live inside the payload of a quiet NaN that arithmetic never 
+// produces:
+//   null, false, true -> QNAN | 1, 2, 3
+//   empty             -> QNAN | 4, no value, only the register machine
+//   string            -> SIGN | QNAN | pointer to the StrObj
+// A value holds a reference to its string, copies share the same object.
+class Value {
+    static const uint64_t SIGN = 0x8000000000000000;
+    static const uint64_t QNAN = 0x7ffc000000000000;
+    static const uint64_t NIL = QNAN | 1;
+    static const uint64_t FALSE = QNAN | 2;
+    static const uint64_t TRUE = QNAN | 3;
+    static const uint64_t EMPTY = QNAN | 4;
+
+    uint64_t Bits;
+
+    void Retain() const {
+        if (IsString()) {
+            AsString()->RefCount++;
+        }
+    }
+
+    void Release() const {
+        if (IsString() && --AsString()->RefCount == 0) {
+            FreeString(AsString());
+        }
+    }
+
+    public:
+        Value() : Bits(NIL) {}
+        Value(std::nullptr_t) : Bits(NIL) {}
+        Value(bool Bool) : Bits(Bool ? TRUE : FALSE) {}
+        Value(double Num) { memcpy(&Bits, &Num, sizeof(Bits)); }
+
+        // Left by a operation that failed, it is not a value of the language
+        static Value Empty() {
+            Value Result;
+            Result.Bits = EMPTY;
+            return Result;
+        }
+
+        // Takes a new reference to the string
+        Value(StrObj* Str) : Bits(SIGN | QNAN | (uint64_t)(uintptr_t)Str) {
+            Retain();
+        }
+
+        Value(const Value& Other) : Bits(Other.Bits) { Retain(); }
+        Value(Value&& Other) : Bits(Other.Bits) { Other.Bits = NIL; }
+        ~Value() { Release(); }
+
+        Value& operator=(const Value& Other) {
+            Other.Retain();
+            Release();
+            Bits = Other.Bits;
+            return *this;
+        }
+
+        Value& operator=(Value&& Other) {
+            if (this != &Other) {
+                Release();
+                Bits = Other.Bits;
+                Other.Bits = NIL;
+            }
+            return *this;
+        }
+
+        bool IsDouble() const { return (Bits & QNAN) != QNAN; }
+        bool IsBool() const { return (Bits | 1) == TRUE; }
+        bool IsNull() const { return Bits == NIL; }
+        bool IsEmpty() const { return Bits == EMPTY; }
+        bool IsString() const { return (Bits & (SIGN | QNAN)) == (SIGN | QNAN); }
+
+        double AsDouble() const { 
+            double Num;
+            memcpy(&Num, &Bits, sizeof(Num));
+            return Num;
+        }
+        bool AsBool() const { return Bits == TRUE; }
+        StrObj* AsString() const { 
+            return (StrObj*)(uintptr_t)(Bits & ~(SIGN | QNAN)); 
+        }
+
+        ValueType Type() const {
+            if (IsDouble()) {
+                return doub;
+            }
+            if (IsString()) {
+                return str;
+            }
+            return IsNull() ? nil : boo;
+        }
+
+        uint64_t Raw() const { return Bits; }
+};
@@ -1,6 +1,7 @@
 #include "global.h"
 
-enum Instruction {
+// Opcodes fit in a single byte so the instruction stream stays compact
+enum Instruction : uint8_t {
     // Types
     ndoubl, // double
     cstr, // string
@@ -27,10 +28,15 @@ enum Instruction {
 
     // Built-in Function
     stio, // print
+
+    // Discard the value of a expression used as statement
+    pop,
     
     // Variables
-    varst, // store
-    varrt, // return
+    varst, // store in the frame
+    varrt, // return from the frame
+    glbst, // store in the globals
+    glbrt, // return from the globals
 
     // Function
     funcsta,
@@ -38,23 +44,81 @@ enum Instruction {
     stop, // used to separated expressions in args
     callfunc,
     retrn,
+    tailcall, // callfunc in the frame of the function, that returns
+
+    // Goto, the offset is relative to the next instruction
+    jmp,
+    jmpf, // jump if the value popped is false
+    jmpt, // jump if the value popped is true
+
+    // Superinstructions, made by the fusion pass. They replace the first
+    // instruction of a sequence and read the operands of the next ones
+    glbcmp, // glbrt, load, comparasion, jmpf or jmpt
+    varcmp, // varrt, load, comparasion, jmpf or jmpt
+    glbarith, // glbrt, load, arithmetic, store
+    vararith, // varrt, load, arithmetic, store
+
+    // Quickened operations. A generic operation rewrites itself to the 
+    // variant for the types of its operands the first time it runs, the
+    // variant goes back to the generic one when its guard fails
+    addnum,
+    addstr,
+    subnum,
+    mulnum,
+    divnum,
+    eqnum,
+    eqstr,
+    ineqnum,
+    ineqstr,
+    grnum,
+    lsnum,
+    greqnum,
+    lseqnum,
+
+    // Typed operations. The compiler proved that both operands are doubles,
+    // they run without any check. Same order as the generic ones
+    addN,
+    subN,
+    mulN,
+    divN,
+    eqN,
+    ineqN,
+    grN,
+    lsN,
+    greqN,
+    lseqN,
 
-    // Goto
-    setto,
     endstk, // End Of Stack
 };
 
+// Every instruction is a fixed width word: the opcode and a immediate operand.
+// Constants don't live in the stream, ndoubl and cstr carry the index of its
+// value in the constant pool and bolen carries the bool itself. The binary
+// operations count in it the times they were de-optimized.
 struct Bytecode {
     Instruction inst;
-    Value data;
-    int offset;
+    int offset = 0;
 };
 
+// Functions are called by their index on the table of functions
+struct Function {
+    int Entry; // first instruction of the body
+    int Locals; // size of the frame
+};
+
+// Operand of a jmp generated by a break that still doesn't know where the
+// loop ends
+const int BREAKPOINT = INT_MIN;
+
 class InstructionStack {
     std::vector<Bytecode> Stack;
+    std::vector<Value> Constants; // constant pool of the program
+    std::unordered_map<uint64_t, int> NumPool; // bits of a immediate to its index
+    std::unordered_map<StrObj*, int> StrPool; // interned string to its index
+    std::vector<Function> Functions; // table of functions
+    int globals; // number of global variables
     int sp; // stack pointer
     int eos; // end of stack
-    int ret; // return state
 
     public:
         InstructionStack() {}
@@ -64,15 +128,31 @@ class InstructionStack {
         int Size();
         void SetEOS();
         int EOS();
-        void SetRet(int);
-        int RET();
-        void ChangeValue(Value, int);
         void Insert(Bytecode, int);
-        Bytecode Return(int);
+        Bytecode* Code();
+        const Bytecode& Return(int);
+        void Replace(std::vector<Bytecode>, const std::vector<int>&);
+
+        // Constant Pool
+        int AddConst(Value); // doubles, bools and null
+        int AddConst(StrObj*);
+        const Value& Const(int);
+        const Value* Pool();
+
+        // Functions
+        int AddFunc();
+        void SetFunc(int, int, int);
+        const Function& Func(int);
+
+        // Variables
+        void SetGlobals(int);
+        int Globals();
+
         void Advance();
         int SP();
         void Goto(int);
         void SetBreaks(int, int);
+        std::vector<bool> Landings();
         #ifdef DEBUG
         void StackReset();
         #endif
@@ -80,11 +160,36 @@ class InstructionStack {
 
 extern InstructionStack CobaluStack;
 
+// Names of the instructions
+extern std::unordered_map<Instruction, std::string> inst_to_str;
+
 // VM Operation
 void InitVM();
 
 // Declaration for codegeneration
 void Compile();
+void SsaCompile(); // through the SSA form
+Instruction getInstruction(int);
+Instruction Typed(Instruction, int Left, int Right);
+int EmitJump(Instruction, int offset = 0);
+void PatchJump(int, int);
 
 // Declaration for execution of code
-void CodeExec(int);
+void CodeExec();
+
+// Quickening
+const int DEOPT_LIMIT = 4; // de-optimizations before a site stays generic
+extern long long Deopts;
+
+// Peephole pass, times each rewrite was done and instructions removed
+extern std::map<std::string, int> Peepholes;
+extern int Eliminated;
+void PeepholeOptimize();
+
+// Superinstructions
+void FuseInstructions();
+int Length(Instruction);
+
+// Profiler, times each instruction was executed
+extern std::vector<long long> Hits;
+void ProfileReport();
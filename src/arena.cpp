@@ -0,0 +1,35 @@
+#include "Headers/arena.h"
+
+#include <cstdlib>
+
+// Definition of the arena of the AST
+Arena AstArena;
+
+// Starts a new chunk, the rest of the current one is left unused. A object
+// bigger than a chunk gets one of its size
+char* Arena::Grow(size_t Size) {
+    size_t Bytes = Size > ChunkSize ? Size : ChunkSize;
+    char* Chunk = (char*)malloc(Bytes);
+    if (!Chunk) {
+        throw std::bad_alloc();
+    }
+    Chunks.push_back(Chunk);
+    Next = Chunk;
+    Limit = Chunk + Bytes;
+    return Chunk;
+}
+
+// Destroys the objects made by New(), the last first, and frees every chunk
+void Arena::Release() {
+    for (size_t i = Cleanups.size(); i > 0; i--) {
+        Cleanups[i-1].second(Cleanups[i-1].first);
+    }
+    Cleanups.clear();
+
+    for (char* Chunk : Chunks) {
+        free(Chunk);
+    }
+    Chunks.clear();
+    Next = nullptr;
+    Limit = nullptr;
+}
@@ -5,37 +5,73 @@
 ////////////                    BLOCK METHODS                      ////////////
 ///////////////////////////////////////////////////////////////////////////////
 
+// Slots of the variables and indexes of the functions of all the blocks
+ScopeTable<VarSlot> VarScopes;
+ScopeTable<int> FuncScopes;
+
+// Number of the next block
+int NextBlock = 0;
+
+// The new block is inside all of its parents
+BlockAST::BlockAST(BlockAST* ParentBlock ,int State)
+    : State(State), ParentBlock(ParentBlock), Frame(!ParentBlock),
+      FrameSize(0), Id(NextBlock++), Last(Id) {
+    for (BlockAST* Block = ParentBlock; Block; Block = Block->ParentBlock) {
+        Block->Last = Id;
+    }
+}
+
 ///   VARIABLES   ///
-int BlockAST::varSetOffset(std::string Variable) {
-    VarMap[Variable] = CobaluStack.Size() - 1;
-    return CobaluStack.Size() - 1;
+VarSlot BlockAST::varSetOffset(StrObj* Variable) {
+    BlockAST* Owner = FrameOwner();
+
+    VarSlot Slot;
+    Slot.Index = Owner->FrameSize++;
+    Slot.Global = !Owner->ParentBlock;
+    VarScopes.Set(this, Variable, Slot);
+    return Slot;
 }
 
-int BlockAST::varGetOffset(std::string Variable) {
-   if(!VarMap.count(Variable)) {
-        if (!ParentBlock) {
-            return -1;
-        }
-        return ParentBlock->varGetOffset(Variable);
+VarSlot BlockAST::varGetOffset(StrObj* Variable) {
+    VarSlot* Slot = VarScopes.Get(this, Variable);
+    if (!Slot) {
+        return {-1, true};
     }
-    return VarMap[Variable];
+    return *Slot;
 }
 
 ///   FUNCTIONS   ///
-int BlockAST::funcSetOffset(std::string Variable) {
-    FuncMap[Variable] = CobaluStack.Size() - 1;
-    return CobaluStack.Size() - 1;
+void BlockAST::funcSetOffset(StrObj* Variable, int Index) {
+    FuncScopes.Set(this, Variable, Index);
+}
+
+int BlockAST::funcGetOffset(StrObj* Variable) {
+    int* Index = FuncScopes.Get(this, Variable);
+    if (!Index) {
+        return -1;
+    }
+    return *Index;
 }
 
-int BlockAST::funcGetOffset(std::string Variable) {
-   if(!FuncMap.count(Variable)) {
-        if (!ParentBlock) {
-            return -1;
-        }
-        return ParentBlock->funcGetOffset(Variable);
+///   FRAMES   ///
+BlockAST* BlockAST::FrameOwner() {
+    BlockAST* Block = this;
+    while (!Block->Frame) {
+        Block = Block->ParentBlock;
     }
-    return FuncMap[Variable];
+    return Block;
+}
+
+// The block stores the variables of its children
+void BlockAST::OwnFrame() {
+    Frame = true;
 }
+
+// Number of slots the frame needs
+int BlockAST::SlotsUsed() {
+    return FrameOwner()->FrameSize;
+}
+
 void BlockAST::ChangeState(int NewState) {
     State = NewState;
 }
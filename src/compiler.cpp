@@ -1,7 +1,10 @@
 #include "Headers/error_log.h"
+#include "Headers/exec.h"
 #include "Headers/lexer.h"
 #include "Headers/parser.h"
 #include "Headers/vcm.h"
+#include "Headers/regvm.h"
+#include "Headers/ssa.h"
 
 // Helper for instructions
 Instruction getInstruction(int Op) {
@@ -44,6 +47,48 @@ Instruction getInstruction(int Op) {
     }
 }
 
+// The variant without checks of a operation whose operands are known doubles
+Instruction Typed(Instruction inst, int Left, int Right) {
+    if (Left != doub || Right != doub) {
+        return inst;
+    }
+    return (Instruction)(addN + (inst - addD));
+}
+
+// The logical operations only run the right side when the left one doesn't
+// decide the result. They are made of jumps, their value is a bool
+bool Logical(int Op) {
+    return Op == TOKEN_AND || Op == TOKEN_OR;
+}
+
+// Generates a jump and returns its place, so where it lands can be set later
+int EmitJump(Instruction inst, int offset) {
+    Bytecode byte;
+    byte.inst = inst;
+    byte.offset = offset;
+    CobaluStack.Push(byte);
+    return CobaluStack.Size() - 1;
+}
+
+// The offset of a jump is relative to the instruction after it
+void PatchJump(int pos, int target) {
+    Bytecode byte = CobaluStack.Return(pos);
+    byte.offset = target - pos - 1;
+    CobaluStack.Insert(byte, pos);
+}
+
+// Generates a statement. Expressions used as statements have its value 
+// discarded, so nothing is left behind on the stack of execution
+void StatementGen(DeclarationAST* Stmt) {
+    Stmt->codegen();
+
+    if (dynamic_cast<ExpressionAST*>(Stmt)) {
+        Bytecode byte;
+        byte.inst = pop;
+        CobaluStack.Push(byte);
+    }
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 ////////////                    CODE GENERATION                    ////////////
 ///////////////////////////////////////////////////////////////////////////////
@@ -51,7 +96,7 @@ Instruction getInstruction(int Op) {
 void DoubleAST::codegen() {
     Bytecode byte;
     byte.inst = ndoubl;
-    byte.data = DoubleValue;
+    byte.offset = CobaluStack.AddConst(DoubleValue);
     CobaluStack.Push(byte);
     return;
 }
@@ -59,7 +104,7 @@ void DoubleAST::codegen() {
 void StringAST::codegen() {
     Bytecode byte;
     byte.inst = cstr;
-    byte.data = StringValue;
+    byte.offset = CobaluStack.AddConst(StringValue);
     CobaluStack.Push(byte);
     return;
 }
@@ -67,7 +112,7 @@ void StringAST::codegen() {
 void BoolAST::codegen() {
     Bytecode byte;
     byte.inst = bolen;
-    byte.data = BoolValue;
+    byte.offset = BoolValue;
     CobaluStack.Push(byte);
     return;
 }
@@ -75,21 +120,69 @@ void BoolAST::codegen() {
 void NullAST::codegen() {
     Bytecode byte;
     byte.inst = none;
-    byte.data = nullptr;
     CobaluStack.Push(byte);
     return;
 }
 
 void OperationAST::codegen() {
+    if (Logical(Op)) {
+        std::vector<int> False;
+        branch(false, False);
+
+        Bytecode byte;
+        byte.inst = bolen;
+        byte.offset = true;
+        CobaluStack.Push(byte);
+        int end = EmitJump(jmp);
+
+        for (int Jump : False) {
+            PatchJump(Jump, CobaluStack.Size());
+        }
+        byte.offset = false;
+        CobaluStack.Push(byte);
+        PatchJump(end, CobaluStack.Size());
+        return;
+    }
+
     LHS->codegen();
     RHS->codegen();
     
     Bytecode byte;
-    byte.inst = getInstruction(Op);
+    byte.inst = Typed(getInstruction(Op), LHS->StaticType(), 
+                      RHS->StaticType());
     CobaluStack.Push(byte);
     return;
 }
 
+void DeclarationAST::branch(bool WhenTrue, std::vector<int>& Jumps) {
+    codegen();
+    Jumps.push_back(EmitJump(WhenTrue ? jmpt : jmpf));
+}
+
+// The left side of a && decides when it fails, the one of a || when it holds.
+// If that is the jump wanted both sides jump, otherwise the left one skips
+// the right one
+void OperationAST::branch(bool WhenTrue, std::vector<int>& Jumps) {
+    if (!Logical(Op)) {
+        DeclarationAST::branch(WhenTrue, Jumps);
+        return;
+    }
+
+    bool Decides = Op == TOKEN_OR;
+    if (Decides == WhenTrue) {
+        LHS->branch(WhenTrue, Jumps);
+        RHS->branch(WhenTrue, Jumps);
+        return;
+    }
+
+    std::vector<int> Skip;
+    LHS->branch(Decides, Skip);
+    RHS->branch(WhenTrue, Jumps);
+    for (int Jump : Skip) {
+        PatchJump(Jump, CobaluStack.Size());
+    }
+}
+
 void UnaryAST::codegen() {
     Expr->codegen();
     
@@ -116,51 +209,52 @@ void PrintAST::codegen() {
 }
 
 void VarValAST::codegen() {
-    // Generates the instruction to return the variable from the 
-    // CobaluStack
-    Bytecode byte;
-    byte.inst = varrt;
-    byte.offset = ParentBlock->varGetOffset(Variable) + 1;
+    // Generates the instruction to return the variable from its slot
+    VarSlot Slot = ParentBlock->varGetOffset(Variable);
     
     // If not found push a null value
-    if (byte.offset == -1) {
-        ErLogs.PushError(Variable, "not identified", 2);        
+    if (Slot.Index == -1) {
+        ErLogs.PushError(Variable->Text, "not identified", 2);        
         Bytecode byte;
         byte.inst = none;
-        byte.data = nullptr;
         CobaluStack.Push(byte);
         return;
     }
     
+    Bytecode byte;
+    byte.inst = Slot.Global ? glbrt : varrt;
+    byte.offset = Slot.Index;
     CobaluStack.Push(byte);
     return;
 }
 
 void VarDeclAST::codegen() {
-    // Generates the instruction to insert a variable in the stack
-    Bytecode byte;
-    byte.inst = varst;
-   
    // Verify if the variable is initialized, if not insert a null
     if (!Expr) {
         Bytecode byte;
         byte.inst = none;
-        byte.data = nullptr;
         CobaluStack.Push(byte);
     } else {
         Expr->codegen();
     }
 
     // Verify if is a declaration or is a reassign of a value.
-    // If is a declaration insert its offset on the table
+    // If is a declaration reserves a slot for it
+    VarSlot Slot;
     if (Decl == 1) {
-        byte.offset = ParentBlock->varSetOffset(Variable) + 1;
-        CobaluStack.Push(byte);
-        return;
+        Slot = ParentBlock->varSetOffset(Variable);
+    } else {
+        Slot = ParentBlock->varGetOffset(Variable);
+        if (Slot.Index == -1) {
+            ErLogs.PushError(Variable->Text, "not identified", 2);
+            return;
+        }
     }
 
-    // Is a reassign so get the offset value
-    byte.offset = ParentBlock->varGetOffset(Variable) + 1;
+    // Generates the instruction to store the value in the slot
+    Bytecode byte;
+    byte.inst = Slot.Global ? glbst : varst;
+    byte.offset = Slot.Index;
     CobaluStack.Push(byte);
     return;
 }
@@ -170,216 +264,145 @@ void InsideAST::codegen() {
         if (!Exec) {
             return;
         }
-        Exec->codegen();
+        StatementGen(Exec.get());
         return;
     }
-    Exec->codegen();
+    StatementGen(Exec.get());
     Chain->codegen();
     return;
 }
 
 void IfAST::codegen() {
     // Generates the code of the condition
-    Cond->codegen();
-
-    Bytecode byte;
-    byte.inst = setto; // goto equivalent
-    CobaluStack.Push(byte);
-
-    // Saves the current place of the instruction on the stack
-    int tmp = CobaluStack.Size() - 1;
+    // If the condition fails jumps over the if block
+    std::vector<int> Skip;
+    Cond->branch(false, Skip);
 
     // Generates the if block
-    IfBlock->codegen();
-
+    StatementGen(IfBlock.get());
 
     if (!ElseBlock) {
-        // Gets position of the stack where it needs to go if the condition fails
-        byte.offset = (CobaluStack.Size() - 1) - tmp;
-
-        // Reinsert the value into the stack
-        CobaluStack.Insert(byte, tmp);
+        for (int Jump : Skip) {
+            PatchJump(Jump, CobaluStack.Size());
+        }
         return;
-    } else {
-        // Gets position of the stack where it needs to go if the condition fails
-        // it needs to go 2 more because of the none of the block and the setto 
-        byte.offset = (CobaluStack.Size() + 1) - tmp;
+    }
 
-        // Reinsert the value into the stack
-        CobaluStack.Insert(byte, tmp);
+    // The if block jumps over the else block
+    int end = EmitJump(jmp);
+    for (int Jump : Skip) {
+        PatchJump(Jump, CobaluStack.Size());
     }
-    
-    // Not very proud of this hack, but for now will do
-    // Generates a always false
-    Bytecode alwfalse;
-    alwfalse.inst = bolen;
-    alwfalse.data = false;
-    CobaluStack.Push(alwfalse);
-
-    // Saves the current place of the instruction on the stack
-    // this place will be used so we can jump off else in the case
-    // the condition is true.
-    CobaluStack.Push(byte);
-    tmp = CobaluStack.Size() - 1;
 
     // Generates the else block
-    ElseBlock->codegen();
-
-    // Gets position of the stack where it needs to go if condition 
-    // succed
-    byte.offset = (CobaluStack.Size() - 1) - tmp;
-    // Reinsert the value into the stack
-    CobaluStack.Insert(byte, tmp);
-
+    StatementGen(ElseBlock.get());
+    PatchJump(end, CobaluStack.Size());
     return;
 }
 
+// The loops test the condition at the bottom, so every iteration only takes
+// one jump. The first test is reached by a jump over the body
 void WhileAST::codegen() {
-    // Saves the current position of the stack, to return later
-    int start = CobaluStack.Size() - 1;
-
-    // Generates the code of the condition
-    Cond->codegen();
-
-    int end = CobaluStack.Size() - 1;
-
-    // Creates the setto to that points to the end of the loop
-    Bytecode endloop;
-    endloop.inst = setto;
-    CobaluStack.Push(endloop);
+    for (auto& Decl : Preheader) {
+        StatementGen(Decl.get());
+    }
 
-    // Saves the position of the endloop
-    int endpos = CobaluStack.Size() - 1;
+    int start = EmitJump(jmp);
 
     // Generates the loop code
-    Loop->codegen();
-
-    // Generates the byte code to return to the start of the loop
-    // Doesn't need to generate always false because block already does it
-    // Generates the setto
-    Bytecode startloop;
-    startloop.inst = setto;
-    startloop.offset = -((CobaluStack.Size()) - start);
-    CobaluStack.Push(startloop);
-
-    // Generates the null so the condition has where to go if fails
-    Bytecode endpoint;
-    endpoint.inst = none;
-    CobaluStack.Push(endpoint);
-
-    // Saves the current position of the stack so we can escape
-    // the loop
-    //int end = CobaluStack.Size() - 1;
-    endloop.offset = (CobaluStack.Size()-2) - end;
-    CobaluStack.Insert(endloop, endpos);
+    StatementGen(Loop.get());
+
+    // Generates the code of the condition, that goes back to the body while
+    // it holds
+    PatchJump(start, CobaluStack.Size());
+    std::vector<int> Back;
+    Cond->branch(true, Back);
+    for (int Jump : Back) {
+        PatchJump(Jump, start + 1);
+    }
 
-    // Set breakpoints if any. (End - 2) we don't need to verify the end anyway
-    CobaluStack.SetBreaks(start, CobaluStack.Size()-1);
+    // Set breakpoints if any, they land after the loop
+    CobaluStack.SetBreaks(start, CobaluStack.Size() - 1);
 }
 
 void ForAST::codegen() {
     // First generates the variable
-    Var->codegen();
-
-    // Saves the current position of the stack, to return later
-    int start = CobaluStack.Size() - 1;
+    StatementGen(Var.get());
+    for (auto& Decl : Preheader) {
+        StatementGen(Decl.get());
+    }
 
-    // Generates the code of the condition
-    Cond->codegen();
+    int start = EmitJump(jmp);
 
-    // Creates the setto to that points to the end of the loop
-    Bytecode endloop;
-    endloop.inst = setto;
-    CobaluStack.Push(endloop);
+    // Generates the loop code and the iterator
+    StatementGen(Loop.get());
+    StatementGen(Iterator.get());
 
-    // Saves the position of the endloop
-    int endpos = CobaluStack.Size() - 1;
+    // Generates the code of the condition
+    PatchJump(start, CobaluStack.Size());
+    std::vector<int> Back;
+    Cond->branch(true, Back);
+    for (int Jump : Back) {
+        PatchJump(Jump, start + 1);
+    }
 
-    // Generates the loop code
-    Loop->codegen();
-
-    // Generates the code of the iterator
-    Iterator->codegen();
-
-    // Generates a always false
-    Bytecode alwfalse;
-    alwfalse.inst = bolen;
-    alwfalse.data = false;
-    CobaluStack.Push(alwfalse);
-
-    // Generates the byte code to return to the start of the loop
-    // Doesn't need to generate always false because block already does it
-    // Generates the setto
-    Bytecode startloop;
-    startloop.inst = setto;
-    startloop.offset = -(CobaluStack.Size() - start);
-    CobaluStack.Push(startloop);
-
-    // Generates the null so the condition has where to go if fails
-    Bytecode endpoint;
-    endpoint.inst = none;
-    CobaluStack.Push(endpoint);
-
-    // Saves the current position of the stack so we can escape
-    // the loop
-    int end = CobaluStack.Size() - 1;
-    endloop.offset = end-endpos;
-    CobaluStack.Insert(endloop, endpos);
-
-    // Set breakpoints if any. (End - 2) we don't need to verify the end anyway
-    CobaluStack.SetBreaks(start, CobaluStack.Size()-1);
+    // Set breakpoints if any, they land after the loop
+    CobaluStack.SetBreaks(start, CobaluStack.Size() - 1);
     return;
 }
 
 void BreakAST::codegen() {
-    // Generates a always false
-    Bytecode alwfalse;
-    alwfalse.inst = bolen;
-    alwfalse.data = false;
-    CobaluStack.Push(alwfalse);
-
-    // Generates the break, it's offset wiil be -1 so we can search it in while
-    Bytecode bytebreak;
-    bytebreak.inst = setto;
-    bytebreak.data = -1.0;
-    bytebreak.offset = CobaluStack.Size();
-    CobaluStack.Push(bytebreak);
-
+    // The offset of the break will be a BREAKPOINT so the loop can search it
+    EmitJump(jmp, BREAKPOINT);
     return;
 }
 
 void FunctionAST::codegen() {
+    // Set the index of the function in both blocks
+    int Index = CobaluStack.AddFunc();
+    ParentBlock->funcSetOffset(Name, Index);
+    Env->funcSetOffset(Name, Index);
+
     Bytecode start;
     start.inst = funcsta;
-    start.data = 0.0;
-
-    // Set the offset of the function in both blocks
-    ParentBlock->funcSetOffset(Name);
-    Env->funcSetOffset(Name);
-
-    start.offset = ParentBlock->funcGetOffset(Name) + 1;
     CobaluStack.Push(start);
+    int startpos = CobaluStack.Size() - 1;
 
-    // Set the variables
+    // The arguments are the first slots of the frame. They are pushed in 
+    // order so they are stored in reverse
+    std::vector<VarSlot> Slots;
+    for (size_t i=0; i < Var.size(); i++) {
+        Slots.push_back(Env->varSetOffset(Var[i]));
+    }
     for (int i=Var.size()-1; i >= 0; i--) {
         Bytecode byte;
         byte.inst = varst;
-        byte.offset = ParentBlock->varSetOffset(Var[i]) + 1;
+        byte.offset = Slots[i].Index;
         CobaluStack.Push(byte);
     }
 
     // Generates the code execution code of the function
-    Exec->codegen();
+    StatementGen(Exec.get());
 
     // Generates the end of the function
     Bytecode end;
     end.inst = funcend;
     CobaluStack.Push(end);
 
+    // The funcsta jumps over the body until the function is called
+    start.offset = (CobaluStack.Size() - 1) - startpos;
+    CobaluStack.Insert(start, startpos);
+
+    CobaluStack.SetFunc(Index, startpos + 1, Env->SlotsUsed());
+
     return;
 }
 
 void CallFuncAST::codegen() {
+    callgen(false);
+}
+
+void CallFuncAST::callgen(bool Tail) {
     for (int i=0; i < VarVal.size(); i++) {
         VarVal[i]->codegen();
         Bytecode byte;
@@ -387,19 +410,21 @@ void CallFuncAST::codegen() {
         CobaluStack.Push(byte);
     }
 
-    // Generates the instruction to return the variable from the
-    // CobaluStack
+    // Generates the instruction to call the function by its index
     Bytecode byte;
-    byte.inst = callfunc;
-    byte.offset = ParentBlock->funcGetOffset(FuncName) + 1;
+    byte.inst = Tail ? tailcall : callfunc;
+    byte.offset = ParentBlock->funcGetOffset(FuncName);
 
     // If not found push a null value
     if (byte.offset == -1) {
-        ErLogs.PushError(FuncName, "not identified", 2);
+        ErLogs.PushError(FuncName->Text, "not identified", 2);
         Bytecode byte;
         byte.inst = none;
-        byte.data = nullptr;
         CobaluStack.Push(byte);
+        if (Tail) {
+            byte.inst = retrn;
+            CobaluStack.Push(byte);
+        }
         return;
     }
 
@@ -408,11 +433,16 @@ void CallFuncAST::codegen() {
 }
 
 void ReturnAST::codegen() {
+    // A call returned right away reuses the frame
+    if (auto Call = dynamic_cast<CallFuncAST*>(RetVal.get())) {
+        Call->callgen(true);
+        return;
+    }
+
     // Generates the code
     if (!RetVal) {
         Bytecode byte;
         byte.inst = none;
-        byte.data = nullptr;
         CobaluStack.Push(byte);
     } else {
         RetVal->codegen();
@@ -425,19 +455,529 @@ void ReturnAST::codegen() {
     return;
 }
 
+// The body runs and leaves the value of the result, like the call did
+void InlineAST::codegen() {
+    for (auto& Stmt : Body) {
+        StatementGen(Stmt.get());
+    }
+    Result->codegen();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+////////////               REGISTER CODE GENERATION                ////////////
+///////////////////////////////////////////////////////////////////////////////
+
+// Temporaries of the frame being generated. They are stacked after the 
+// variables and only live until the end of the statement
+int RegTemps = 0; // temporaries in use
+int RegMaxTemps = 0; // temporaries needed by the frame
+
+// Farthest place where a jump lands, the instructions before it may be
+// reached from more than one place
+int RegJoin = 0;
+
+// Jumps of the breaks of each loop being generated
+std::vector<std::vector<int>> RegBreaks;
+
+// Helper for instructions
+RegInstruction getRegInstruction(int Op) {
+    switch (getInstruction(Op)) {
+        case addD: return radd;
+        case subD: return rsub;
+        case mulD: return rmul;
+        case divD: return rdiv;
+        case eqD: return req;
+        case ineqD: return rineq;
+        case grD: return rgr;
+        case lsD: return rls;
+        case greqD: return rgreq;
+        default: return rlseq;
+    }
+}
+
+int RegEmit(RegInstruction inst, int a = 0, int b = 0, int c = 0) {
+    RegBytecode byte;
+    byte.inst = inst;
+    byte.a = a;
+    byte.b = b;
+    byte.c = c;
+    return RegStack.Push(byte);
+}
+
+// Points the jump to the target
+void RegPatch(int Jump, int Target) {
+    if (std::abs(Target - Jump) >= 1 << 23) {
+        LimitError("jump too long for the register machine, the limit is",
+                   1 << 23);
+    }
+    RegStack.At(Jump).SetJump(Target - Jump);
+    RegJoin = std::max(RegJoin, Target);
+}
+
+int RegOperand(uint16_t Kind, int Index) {
+    if (Index > OPERAND_INDEX) {
+        LimitError("too many operands of the same kind, the limit is",
+                   OPERAND_INDEX + 1);
+    }
+    return Kind | Index;
+}
+
+int NewTemp() {
+    int Temp = RegOperand(TEMP, RegTemps++);
+    RegMaxTemps = std::max(RegMaxTemps, RegTemps);
+    return Temp;
+}
+
+int RegNull() {
+    return RegOperand(KONST, CobaluStack.AddConst(Value(nullptr)));
+}
+
+int RegVar(VarSlot Slot) {
+    return RegOperand(Slot.Global ? GLOB : REG, Slot.Index);
+}
+
+// A variable read before a expression that can change it is copied, so the
+// operation sees the value it had
+int RegKeep(int Operand, DeclarationAST* Next) {
+    int Kind = Operand & TEMP;
+    if ((Kind == REG || Kind == GLOB) && Next->HasEffects()) {
+        int Temp = NewTemp();
+        RegEmit(rmove, Temp, Operand);
+        return Temp;
+    }
+    return Operand;
+}
+
+// Stores the value in the operand. When the last instruction made a 
+// temporary only for it, the instruction writes there instead
+void RegStore(int Dst, int Src) {
+    if (Dst == Src) {
+        return;
+    }
+
+    int Last = RegStack.Size() - 1;
+    if ((Src & TEMP) == TEMP && Last >= RegJoin) {
+        RegBytecode& byte = RegStack.At(Last);
+        if (byte.inst <= rmove && byte.a == Src) {
+            byte.a = Dst;
+            return;
+        }
+    }
+    RegEmit(rmove, Dst, Src);
+}
+
+// Generates a statement, its temporaries are free after it
+void RegStatementGen(DeclarationAST* Stmt) {
+    int Temps = RegTemps;
+    Stmt->regcodegen();
+    RegTemps = Temps;
+}
+
+// Breaks jump to the end of the loop
+void RegLoopEnd() {
+    for (int Jump : RegBreaks.back()) {
+        RegPatch(Jump, RegStack.Size());
+    }
+    RegBreaks.pop_back();
+}
+
+// Statements don't have a value, they return -1
+
+int DoubleAST::regcodegen() {
+    return RegOperand(KONST, CobaluStack.AddConst(DoubleValue));
+}
+
+int StringAST::regcodegen() {
+    return RegOperand(KONST, CobaluStack.AddConst(StringValue));
+}
+
+int BoolAST::regcodegen() {
+    return RegOperand(KONST, CobaluStack.AddConst(BoolValue));
+}
+
+int NullAST::regcodegen() {
+    return RegNull();
+}
+
+int OperationAST::regcodegen() {
+    if (Logical(Op)) {
+        std::vector<int> False;
+        regbranch(false, False);
+
+        int Dst = NewTemp();
+        RegEmit(rmove, Dst, RegOperand(KONST, CobaluStack.AddConst(true)));
+        int End = RegEmit(rjmp);
+        for (int Jump : False) {
+            RegPatch(Jump, RegStack.Size());
+        }
+        RegEmit(rmove, Dst, RegOperand(KONST, CobaluStack.AddConst(false)));
+        RegPatch(End, RegStack.Size());
+        return Dst;
+    }
+
+    int Temps = RegTemps;
+    int Left = RegKeep(LHS->regcodegen(), RHS.get());
+    int Right = RHS->regcodegen();
+    RegTemps = Temps;
+
+    int Dst = NewTemp();
+    RegEmit(getRegInstruction(Op), Dst, Left, Right);
+    return Dst;
+}
+
+// A condition that fails jumps with regbranch(false), one that succeeds with
+// regbranch(true)
+void DeclarationAST::regbranch(bool WhenTrue, std::vector<int>& Jumps) {
+    int Temps = RegTemps;
+    int Cond = regcodegen();
+    RegTemps = Temps;
+
+    Jumps.push_back(RegEmit(WhenTrue ? rjmpt : rjmpf, Cond));
+}
+
+// Comparasions jump without storing the result, the logical operations like
+// in branch()
+void OperationAST::regbranch(bool WhenTrue, std::vector<int>& Jumps) {
+    if (Logical(Op)) {
+        bool Decides = Op == TOKEN_OR;
+        if (Decides == WhenTrue) {
+            LHS->regbranch(WhenTrue, Jumps);
+            RHS->regbranch(WhenTrue, Jumps);
+            return;
+        }
+
+        std::vector<int> Skip;
+        LHS->regbranch(Decides, Skip);
+        RHS->regbranch(WhenTrue, Jumps);
+        for (int Jump : Skip) {
+            RegPatch(Jump, RegStack.Size());
+        }
+        return;
+    }
+
+    RegInstruction inst = getRegInstruction(Op);
+    if (inst < req) {
+        DeclarationAST::regbranch(WhenTrue, Jumps);
+        return;
+    }
+
+    int Temps = RegTemps;
+    int Left = RegKeep(LHS->regcodegen(), RHS.get());
+    int Right = RHS->regcodegen();
+    RegTemps = Temps;
+
+    int Jump = (WhenTrue ? rjeq : rjneq) + (inst - req);
+    Jumps.push_back(RegEmit((RegInstruction)Jump, Left, Right));
+}
+
+int UnaryAST::regcodegen() {
+    int Temps = RegTemps;
+    int Operand = Expr->regcodegen();
+    RegTemps = Temps;
+
+    int Dst = NewTemp();
+    RegEmit(Op == TOKEN_MINUS ? rinv : rneg, Dst, Operand);
+    return Dst;
+}
+
+int PrintAST::regcodegen() {
+    RegEmit(rprint, Expr->regcodegen());
+    return -1;
+}
+
+int VarValAST::regcodegen() {
+    VarSlot Slot = ParentBlock->varGetOffset(Variable);
+    
+    // If not found use a null value
+    if (Slot.Index == -1) {
+        ErLogs.PushError(Variable->Text, "not identified", 2);        
+        return RegNull();
+    }
+    return RegVar(Slot);
+}
+
+int VarDeclAST::regcodegen() {
+    // The value is generated before the slot is reserved, like in the stack
+    int Src = Expr ? Expr->regcodegen() : RegNull();
+
+    VarSlot Slot;
+    if (Decl == 1) {
+        Slot = ParentBlock->varSetOffset(Variable);
+    } else {
+        Slot = ParentBlock->varGetOffset(Variable);
+        if (Slot.Index == -1) {
+            ErLogs.PushError(Variable->Text, "not identified", 2);
+            return Src;
+        }
+    }
+
+    int Dst = RegVar(Slot);
+    RegStore(Dst, Src);
+    return Dst;
+}
+
+int InsideAST::regcodegen() {
+    if (Exec) {
+        RegStatementGen(Exec.get());
+    }
+    if (Chain) {
+        Chain->regcodegen();
+    }
+    return -1;
+}
+
+int IfAST::regcodegen() {
+    std::vector<int> Jumps;
+    Cond->regbranch(false, Jumps);
+    RegStatementGen(IfBlock.get());
+
+    if (!ElseBlock) {
+        for (int Jump : Jumps) {
+            RegPatch(Jump, RegStack.Size());
+        }
+        return -1;
+    }
+
+    // The if block jumps over the else
+    int Skip = RegEmit(rjmp);
+    for (int Jump : Jumps) {
+        RegPatch(Jump, RegStack.Size());
+    }
+    RegStatementGen(ElseBlock.get());
+    RegPatch(Skip, RegStack.Size());
+    return -1;
+}
+
+// The condition of the loops is generated after the body, so every iteration
+// only jumps once, back to the start when the condition succeeds
+int WhileAST::regcodegen() {
+    for (auto& Decl : Preheader) {
+        RegStatementGen(Decl.get());
+    }
+
+    int Enter = RegEmit(rjmp);
+    int Body = RegStack.Size();
+
+    RegBreaks.push_back({});
+    RegStatementGen(Loop.get());
+
+    RegPatch(Enter, RegStack.Size());
+    std::vector<int> Back;
+    Cond->regbranch(true, Back);
+    for (int Jump : Back) {
+        RegPatch(Jump, Body);
+    }
+    RegLoopEnd();
+    return -1;
+}
+
+int ForAST::regcodegen() {
+    RegStatementGen(Var.get());
+    for (auto& Decl : Preheader) {
+        RegStatementGen(Decl.get());
+    }
+
+    int Enter = RegEmit(rjmp);
+    int Body = RegStack.Size();
+
+    RegBreaks.push_back({});
+    RegStatementGen(Loop.get());
+    RegStatementGen(Iterator.get());
+
+    RegPatch(Enter, RegStack.Size());
+    std::vector<int> Back;
+    Cond->regbranch(true, Back);
+    for (int Jump : Back) {
+        RegPatch(Jump, Body);
+    }
+    RegLoopEnd();
+    return -1;
+}
+
+int BreakAST::regcodegen() {
+    if (!RegBreaks.empty()) {
+        RegBreaks.back().push_back(RegEmit(rjmp));
+    }
+    return -1;
+}
+
+int FunctionAST::regcodegen() {
+    // Set the index of the function in both blocks
+    int Index = RegStack.AddFunc();
+    ParentBlock->funcSetOffset(Name, Index);
+    Env->funcSetOffset(Name, Index);
+
+    // The body only runs when called, jump over it
+    int Skip = RegEmit(rjmp);
+    int Entry = RegStack.Size();
+
+    // The function has its own frame
+    int Temps = RegTemps;
+    int MaxTemps = RegMaxTemps;
+    RegTemps = RegMaxTemps = 0;
+
+    // The arguments are the first registers of the frame
+    for (size_t i=0; i < Var.size(); i++) {
+        Env->varSetOffset(Var[i]);
+    }
+    RegStack.SetFunc(Index, Entry, Var.size(), 1);
+
+    RegStatementGen(Exec.get());
+    RegEmit(rfuncend);
+
+    int Locals = Env->SlotsUsed();
+    RegStack.Relocate(Entry, RegStack.Size(), Locals);
+    RegStack.SetFunc(Index, Entry, Var.size(), 
+                     std::max(1, Locals + RegMaxTemps));
+    RegPatch(Skip, RegStack.Size());
+
+    RegTemps = Temps;
+    RegMaxTemps = MaxTemps;
+    return -1;
+}
+
+int CallFuncAST::regcodegen() {
+    return regcallgen(false);
+}
+
+int CallFuncAST::regcallgen(bool Tail) {
+    int Index = ParentBlock->funcGetOffset(FuncName);
+
+    // If not found use a null value
+    if (Index == -1) {
+        ErLogs.PushError(FuncName->Text, "not identified", 2);
+        if (Tail) {
+            RegEmit(rret, RegNull());
+        }
+        return RegNull();
+    }
+
+    // The arguments go on consecutive temporaries, the first one receives the
+    // value returned
+    int Params = RegStack.Func(Index).Params;
+    int Temps = RegTemps;
+    int Args = NewTemp();
+    for (int i=1; i < Params; i++) {
+        NewTemp();
+    }
+
+    // Like on the stack machine the arguments go to the last parameters. The
+    // extra ones before them are only computed, the missing ones are the 
+    // first parameters, null, and the call reports them
+    int Passed = VarVal.size();
+    int Missing = Params - Passed;
+    for (int i=0; i < Passed; i++) {
+        int Arg = VarVal[i]->regcodegen();
+        if (i + Missing >= 0) {
+            RegStore(Args + i + Missing, Arg);
+        }
+        RegTemps = Temps + std::max(Params, 1);
+    }
+    for (int i=0; i < Missing; i++) {
+        RegStore(Args + i, RegNull());
+    }
+
+    RegEmit(Tail ? rtail : rcall, Args, Index, std::max(Missing, 0));
+    RegTemps = Temps + 1;
+    return Args;
+}
+
+int ReturnAST::regcodegen() {
+    if (auto Call = dynamic_cast<CallFuncAST*>(RetVal.get())) {
+        Call->regcallgen(true);
+        return -1;
+    }
+    RegEmit(rret, RetVal ? RetVal->regcodegen() : RegNull());
+    return -1;
+}
+
+int InlineAST::regcodegen() {
+    for (auto& Stmt : Body) {
+        RegStatementGen(Stmt.get());
+    }
+    return Result->regcodegen();
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 ////////////                    FRONT COMPILER                     ////////////
 ///////////////////////////////////////////////////////////////////////////////
 
-void Compile() {
-    // Generate the global block 
-    std::shared_ptr<BlockAST> Global = 
-        std::make_shared<BlockAST>(nullptr, GLOBAL);
+// Parses the whole program, the optimizations need all of it. The nodes and
+// the blocks are in the arena of the AST, released at once after the code
+// is generated
+std::vector<std::unique_ptr<DeclarationAST>> 
+ParseProgram(BlockAST* Global) {
+    std::vector<std::unique_ptr<DeclarationAST>> Program;
 
     std::unique_ptr<DeclarationAST> Decl = Parser(Global);
-
     while (Decl) {
-        Decl->codegen();
+        Program.push_back(std::move(Decl));
         Decl = Parser(Global);
     }
+
+    // The statements that failed are missing from the tree, a program that
+    // doesn't parse is not compiled
+    if (ErLogs.NumParseErrors()) {
+        ErLogs.ShowErrors();
+        exit(1);
+    }
+
+    if (CobaluOpts.Optimize) {
+        OptimizeProgram(Program);
+    } else if (CobaluOpts.Ssa) {
+        ResolveProgram(Program);
+    }
+    return Program;
+}
+
+void Compile() {
+    // Generate the global block 
+    BlockAST* Global = AstArena.New<BlockAST>(nullptr, GLOBAL);
+
+    for (auto& Decl : ParseProgram(Global)) {
+        StatementGen(Decl.get());
+    }
+
+    CobaluStack.SetGlobals(Global->SlotsUsed());
+    AstArena.Release();
+}
+
+void RegCompile() {
+    // Generate the global block 
+    BlockAST* Global = AstArena.New<BlockAST>(nullptr, GLOBAL);
+
+    for (auto& Decl : ParseProgram(Global)) {
+        RegStatementGen(Decl.get());
+    }
+    RegEmit(rend);
+
+    CobaluStack.SetGlobals(Global->SlotsUsed());
+    RegStack.SetRegisters(std::max(1, RegMaxTemps));
+    AstArena.Release();
+}
+
+// The global code and the functions go through the SSA form. The functions
+// go first, the code jumps over them to the global code
+void SsaCompile() {
+    BlockAST* Global = AstArena.New<BlockAST>(nullptr, GLOBAL);
+
+    IrFunction Main;
+    IrStart(&Main);
+    for (auto& Decl : ParseProgram(Global)) {
+        Decl->irgen();
+    }
+    IrEmit(iend);
+    AstArena.Release();
+
+    int skip = IrFunctions.empty() ? -1 : EmitJump(jmp);
+    for (auto& Func : IrFunctions) {
+        SsaOptimize(*Func);
+        SsaLower(*Func, Func->Params);
+    }
+    if (skip != -1) {
+        PatchJump(skip, CobaluStack.Size());
+    }
+
+    SsaOptimize(Main);
+    CobaluStack.SetGlobals(SsaLower(Main, IrShared));
 }
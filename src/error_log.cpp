@@ -4,8 +4,9 @@ void Logging::ShowErrors() {
     for (int i=0; i < StackError.size(); i++) {
         // 1 is a warning
         if (StackError[i].Level == 1){
-            printf("Warning: %s %s. Line %d\n", StackError[i].Id.c_str(), 
-                StackError[i].Error.c_str(), StackError[i].Line);
+            printf("Warning: %s %s. Line %d, column %d\n",
+                StackError[i].Id.c_str(), StackError[i].Error.c_str(),
+                StackError[i].Line, StackError[i].Column);
         }
         // 2 is a execution error
         if (StackError[i].Level == 2) {
@@ -25,7 +26,8 @@ void Logging::PushError(std::string Identifier, std::string Error, int Level) {
     // 1 is for errors during parser
     // 2 is for errors during execution
     if (Level == 1){
-        Message.Line = LineNumber;
+        Message.Line = Line;
+        Message.Column = Column;
     }
     StackError.push_back(Message);
 }
@@ -35,7 +37,17 @@ int Logging::NumErrors() {
     return StackError.size();
 }
 
-// Keep track of line number
-void Logging::AddLine() {
-    LineNumber += 1;
+// Return the number of errors found by the parser
+int Logging::NumParseErrors() {
+    int Count = 0;
+    for (size_t i=0; i < StackError.size(); i++) {
+        Count += StackError[i].Level == 1;
+    }
+    return Count;
+}
+
+// Keep track of the position in the source
+void Logging::SetPosition(int Line, int Column) {
+    this->Line = Line;
+    this->Column = Column;
 }
@@ -5,219 +5,402 @@
 
 // Verification for Types
 int TypesMatch(int R, int L) {
-    if (R == doub && L == str) {
-        return 0;
-    }
-    if (R == boo && L == doub) {
-        return 0;
-    }
-    if (R == doub && L == boo) {
-        return 0;
-    }
-    if (R == str && L == doub) {
-        return 0;
-    }
-    if (R == boo && L == str) {
-        return 0;
-    }
-    if (R == str && L == boo) {
-        return 0;
-    }
-    if (R == nil || L == nil) {
-        return 0;
-    }
-    return 1;
+    return R == L && R != nil;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 ////////////                    BYTECODE OPERATIONS                ////////////
 ///////////////////////////////////////////////////////////////////////////////
 
-// If the stack of values is empty return a error
-int Calculus::EmptyStack() {
-    if (Calc.empty()) {
+// If the stack of values doesn't have the operands return a error. The
+// operands that are there are dropped, like the ones of a operation that
+// fails, so the next operations don't take them
+int Calculus::EmptyStack(size_t Operands) {
+    if (Calc.size() < Operands) {
         ErLogs.PushError("", \
             "illegal instruction stack of execution is empty", 2);        
+        Calc.clear();
         return 1;
     }
     return 0;
 }
 
+// Going over one of the limits of the VM stops the execution
+void LimitError(std::string Error, long Limit) {
+    ErLogs.PushError(std::to_string(Limit), Error, 2);
+    ErLogs.ShowErrors();
+    exit(1);
+}
+
 // Insert Values on the stack of execution
 void Calculus::PushCalc(Value byte) {
-    Calc.push_back(byte);
+    if (Calc.size() >= (size_t)CobaluOpts.StackLimit) {
+        LimitError("stack of execution overflow, the limit is",
+                   CobaluOpts.StackLimit);
+    }
+    Calc.push_back(std::move(byte));
 }
 
+// Discard the top of the stack. A operation that failed already reported it
+// and left nothing behind, so there is nothing to complain about
+void Calculus::popData() {
+    if (!Calc.empty()) {
+        Calc.pop_back();
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+////////////                    VALUE OPERATIONS                   ////////////
+///////////////////////////////////////////////////////////////////////////////
+
 // double + double
 // strint + string
-void Calculus::addData() {
-    if (EmptyStack()) {
-        return;
+int AddValues(const Value& Left, const Value& Right, Value& Result) {
+    if (Left.IsDouble() && Right.IsDouble()) {
+        Result = Left.AsDouble() + Right.AsDouble();
+        return 1;
     }
 
-    Value Right = Calc.back();
-    Calc.pop_back();
-
-    Value Left = Calc.back();
-    Calc.pop_back();
-    
     // If is not a string or a a double give a error
-    if ((Right.index()%2) || (Left.index()%2)) {
+    if ((!Right.IsDouble() && !Right.IsString()) || 
+        (!Left.IsDouble() && !Left.IsString())) {
         ErLogs.PushError("", "operation on type not permited", 2);
-        return;
+        return 0;
     }
     // It the types are not the same give a error
-    if (Right.index() != Left.index()) {
+    if (Right.Type() != Left.Type()) {
         ErLogs.PushError("", "types don't match", 2);        
-        return;
+        return 0;
     } 
 
-    if (!Left.index()) {
-        Right = std::get<double>(Left) + std::get<double>(Right);
-        Calc.push_back(Right);
-        return;
+    Result = ConcatString(Left.AsString(), Right.AsString());
+    return 1;
+}
+
+// Verify the operands of arithmetic that only works with doubles
+int NumOperands(const Value& Left, const Value& Right) {
+    if (Right.Type() != Left.Type()) {
+        ErLogs.PushError("", "types don't match", 2);        
+        return 0;
     }
-    if (Left.index() == str) {
-        Right = std::get<std::string>(Left) + std::get<std::string>(Right);
-        Calc.push_back(Right);
-        return;
+    if (Right.IsString()) {
+        ErLogs.PushError("", "illegal instruction in strings", 2);        
+        return 0;
+    }
+    if (!Right.IsDouble()) {
+        ErLogs.PushError("", "operation on type not permited", 2);
+        return 0;
     }
+    return 1;
 }
 
 // double - double
-void Calculus::subData() {
-    if (EmptyStack()) {
-        return;
+int SubValues(const Value& Left, const Value& Right, Value& Result) {
+    if (!NumOperands(Left, Right)) {
+        return 0;
     }
+    Result = Left.AsDouble() - Right.AsDouble();
+    return 1;
+}
 
-    Value Right = Calc.back();
-    Calc.pop_back();
+// double * double
+int MulValues(const Value& Left, const Value& Right, Value& Result) {
+    if (!NumOperands(Left, Right)) {
+        return 0;
+    }
+    Result = Left.AsDouble() * Right.AsDouble();
+    return 1;
+}
 
-    Value Left = Calc.back();
-    Calc.pop_back();
+// double / double
+int DivValues(const Value& Left, const Value& Right, Value& Result) {
+    if (!NumOperands(Left, Right)) {
+        return 0;
+    }
+    Result = Left.AsDouble() / Right.AsDouble();
+    return 1;
+}
 
-    if (Right.index() != Left.index()) {
-        ErLogs.PushError("", "types don't match", 2);        
-        return;
+// - double
+int InvsigValue(const Value& Expr, Value& Result) {
+    if (Expr.IsDouble()) {
+        Result = -Expr.AsDouble();
+        return 1;
     }
-    // I already search to see if the types are equal, if they are equal but
-    // are also a string give a error
-    if (Right.index() == str) {
+
+    if (Expr.IsBool()) {
+        ErLogs.PushError("", "illegal instruction on booleans", 2);        
+        return 0;
+    }
+    if (Expr.IsString()) {
         ErLogs.PushError("", "illegal instruction in strings", 2);        
-        return;
+        return 0;
     }
+    ErLogs.PushError("", "operation on type not permited", 2);
+    return 0;
+}
 
-    Right = std::get<double>(Left) - std::get<double>(Right);
-    Calc.push_back(Right);
+// ! double
+// ! bool
+int NegValue(const Value& Expr, Value& Result) {
+    switch (Expr.Type()) {
+        case doub: {
+            Result = !Expr.AsDouble() ? 1.0 : 0.0;
+            return 1;
+        }
+        case boo: {
+            Result = !Expr.AsBool();
+            return 1;
+        }
+        case str: {
+            ErLogs.PushError("", "illegal instruction in strings", 2);        
+            return 0;
+        }
+        default: {
+            ErLogs.PushError("", "operation on type not permited", 2);
+            return 0;
+        }
+    }
 }
 
-// double * double
-void Calculus::mulData() {
-    if (EmptyStack()) {
+// Equality of two values of the same type
+bool EqualValues(const Value& Left, const Value& Right) {
+    if (Left.IsString()) {
+        return EqualStrings(Left.AsString(), Right.AsString());
+    }
+    if (Left.IsDouble()) {
+        return Left.AsDouble() == Right.AsDouble();
+    }
+    return Left.Raw() == Right.Raw();
+}
+
+// double == double
+// bool == bool
+// string == string
+int EqValues(const Value& Left, const Value& Right, Value& Result) {
+    if (!TypesMatch(Left.Type(), Right.Type())) {
+        ErLogs.PushError("", "types don't match", 2);        
+        return 0;
+    }
+    Result = EqualValues(Left, Right);
+    return 1;
+}
+
+// double != double
+// bool != bool
+// string != string
+int IneqValues(const Value& Left, const Value& Right, Value& Result) {
+    if (!TypesMatch(Left.Type(), Right.Type())) {
+        ErLogs.PushError("", "types don't match", 2);        
+        return 0;
+    }
+    Result = !EqualValues(Left, Right);
+    return 1;
+}
+
+// Verify the operands of a comparasion, they can be doubles or bools. Bools 
+// are compared as numbers
+int CmpOperands(const Value& Left, const Value& Right) {
+    if (!TypesMatch(Left.Type(), Right.Type())) {
+        ErLogs.PushError("", "types don't match", 2);        
+        return 0;
+    }
+    if(Right.IsString()) {
+        ErLogs.PushError("", "operation not permited on strings", 2);        
+        return 0;
+    }
+    return 1;
+}
+
+// Number of a double or bool used in a comparasion
+double CmpNum(const Value& Val) {
+    return Val.IsDouble() ? Val.AsDouble() : Val.AsBool();
+}
+
+// double > double
+// bool > bool
+int GrValues(const Value& Left, const Value& Right, Value& Result) {
+    if (!CmpOperands(Left, Right)) {
+        return 0;
+    }
+    Result = CmpNum(Left) > CmpNum(Right);
+    return 1;
+}
+
+// double < double
+// bool < bool
+int LsValues(const Value& Left, const Value& Right, Value& Result) {
+    if (!CmpOperands(Left, Right)) {
+        return 0;
+    }
+    Result = CmpNum(Left) < CmpNum(Right);
+    return 1;
+}
+
+// double >= double
+// bool >= bool
+int GreqValues(const Value& Left, const Value& Right, Value& Result) {
+    if (!CmpOperands(Left, Right)) {
+        return 0;
+    }
+    Result = CmpNum(Left) >= CmpNum(Right);
+    return 1;
+}
+
+// double <= double
+// bool <= bool
+int LseqValues(const Value& Left, const Value& Right, Value& Result) {
+    if (!CmpOperands(Left, Right)) {
+        return 0;
+    }
+    Result = CmpNum(Left) <= CmpNum(Right);
+    return 1;
+}
+
+// Built-in Print
+void PrintValue(const Value& tmp) {
+    switch(tmp.Type()) {
+        case doub: {
+            printf("%g\n", tmp.AsDouble());
+            break;
+        }
+        case boo: {
+            if(tmp.AsBool()) {
+                printf("true\n");
+            } else {
+                printf("false\n");
+            }
+            break;
+        }
+        case str: {
+            printf("'%s'\n", tmp.AsString()->Text);
+            break;
+        }
+        default: {
+            printf("null\n");
+            break;
+        }
+    }
+}
+
+// Evaluate a condition, returns 1 if the condition failed and the VM needs to
+// jump
+int FalseValue(const Value& cond) {
+    switch (cond.Type()) {
+        case doub: {
+            return !cond.AsDouble();
+        }
+        case boo: {
+            return !cond.AsBool();
+        }
+        case str: {
+            ErLogs.PushError(cond.AsString()->Text, 
+                "string type is not supported in conditions", 2);
+            return 0;
+        }
+        default: {
+            return 1;
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+////////////                    STACK OPERATIONS                   ////////////
+///////////////////////////////////////////////////////////////////////////////
+
+// The doubles are handled before calling the operation on values, it is the 
+// common case
+
+// double + double
+// strint + string
+void Calculus::addData() {
+    if (EmptyStack(2)) {
         return;
     }
 
-    Value Right = Calc.back();
+    Value Right = std::move(Calc.back());
     Calc.pop_back();
 
-    Value Left = Calc.back();
+    Value Left = std::move(Calc.back());
     Calc.pop_back();
     
-    if (Right.index() != Left.index()) {
-        ErLogs.PushError("", "types don't match", 2);        
-        return;
-    }
-    if (Right.index() == str) {
-        ErLogs.PushError("", "illegal instruction in strings", 2);        
+    if (Left.IsDouble() && Right.IsDouble()) {
+        Calc.push_back(Left.AsDouble() + Right.AsDouble());
         return;
     }
 
-    Right = std::get<double>(Left) * std::get<double>(Right);
-    Calc.push_back(Right);
+    Value Result;
+    if (AddValues(Left, Right, Result)) {
+        Calc.push_back(std::move(Result));
+    }
 }
 
-// double / double
-void Calculus::divData() {
-    if (EmptyStack()) {
+// double - double
+void Calculus::subData() {
+    if (EmptyStack(2)) {
         return;
     }
 
-    Value Right = Calc.back();
+    Value Right = std::move(Calc.back());
     Calc.pop_back();
 
-    Value Left = Calc.back();
+    Value Left = std::move(Calc.back());
     Calc.pop_back();
     
-    if (Right.index() != Left.index()) {
-        ErLogs.PushError("", "types don't match", 2);        
-        return;
-    }
-    if (Right.index() == str) {
-        ErLogs.PushError("", "illegal instruction in strings", 2);        
+    if (Left.IsDouble() && Right.IsDouble()) {
+        Calc.push_back(Left.AsDouble() - Right.AsDouble());
         return;
     }
 
-    Right = std::get<double>(Left) / std::get<double>(Right);
-    Calc.push_back(Right);
+    Value Result;
+    if (SubValues(Left, Right, Result)) {
+        Calc.push_back(std::move(Result));
+    }
 }
 
-// - double
-void Calculus::invsigData() {
-    if (EmptyStack()) {
+// double * double
+void Calculus::mulData() {
+    if (EmptyStack(2)) {
         return;
     }
 
-    Value Expr = Calc.back();
+    Value Right = std::move(Calc.back());
     Calc.pop_back();
-   
-    if (Expr.index() == boo) {
-        ErLogs.PushError("", "illegal instruction on booleans", 2);        
-        return;
-    }
-    if (Expr.index() == str) {
-        ErLogs.PushError("", "illegal instruction in strings", 2);        
+
+    Value Left = std::move(Calc.back());
+    Calc.pop_back();
+    
+    if (Left.IsDouble() && Right.IsDouble()) {
+        Calc.push_back(Left.AsDouble() * Right.AsDouble());
         return;
     }
 
-    Calc.push_back(-std::get<double>(Expr));
+    Value Result;
+    if (MulValues(Left, Right, Result)) {
+        Calc.push_back(std::move(Result));
+    }
 }
 
-// ! double
-// ! bool
-void Calculus::negData() {
-    if (EmptyStack()) {
+// double / double
+void Calculus::divData() {
+    if (EmptyStack(2)) {
         return;
     }
 
-    Value Expr = Calc.back();
+    Value Right = std::move(Calc.back());
+    Calc.pop_back();
+
+    Value Left = std::move(Calc.back());
     Calc.pop_back();
     
-    if (Expr.index() == str) {
-        ErLogs.PushError("", "illegal instruction in strings", 2);        
+    if (Left.IsDouble() && Right.IsDouble()) {
+        Calc.push_back(Left.AsDouble() / Right.AsDouble());
         return;
     }
 
-    if (Expr.index() == doub){
-        if(!std::get<double>(Expr)) {
-            Value tmp = 1.0;
-            Calc.push_back(tmp);
-            return;
-        } else {
-            Value tmp = 0.0;
-            Calc.push_back(tmp);
-            return;
-        }
-    }
-    if (Expr.index() == boo) {
-        if(!std::get<bool>(Expr)) {
-            Value tmp = true;
-            Calc.push_back(tmp);
-            return;
-        } else {
-            Value tmp = false;
-            Calc.push_back(tmp);
-            return;
-        }
+    Value Result;
+    if (DivValues(Left, Right, Result)) {
+        Calc.push_back(std::move(Result));
     }
 }
 
@@ -225,233 +408,206 @@ void Calculus::negData() {
 // bool == bool
 // string == string
 void Calculus::eqData() {
-    if (EmptyStack()) {
+    if (EmptyStack(2)) {
         return;
     }
 
-    Value Right = Calc.back();
+    Value Right = std::move(Calc.back());
     Calc.pop_back();
 
-    Value Left = Calc.back();
+    Value Left = std::move(Calc.back());
     Calc.pop_back();
-   
-    if (!TypesMatch(Left.index(), Right.index())) {
-        ErLogs.PushError("", "types don't match", 2);        
+    
+    if (Left.IsDouble() && Right.IsDouble()) {
+        Calc.push_back(Left.AsDouble() == Right.AsDouble());
         return;
     }
 
-    if (Right.index() == doub && Left.index() == doub){
-        Right = (std::get<double>(Left) == std::get<double>(Right));
-        Calc.push_back(Right);
-        return;
-    }
-    if (Right.index() == str){
-        Right = std::get<std::string>(Left) == std::get<std::string>(Right);
-        printf("%d\n", std::get<bool>(Right));
-        Calc.push_back(Right);
-        return;
+    Value Result;
+    if (EqValues(Left, Right, Result)) {
+        Calc.push_back(std::move(Result));
     }
-    if (Right.index() == boo && Right.index() == boo){
-        Right = std::get<bool>(Left) == std::get<bool>(Right);
-        printf("%d\n", std::get<bool>(Right));
-        Calc.push_back(Right);
-        return;
-    }
-    return;
 }
 
 // double != double
 // bool != bool
 // string != string
 void Calculus::ineqData() {
-    if (EmptyStack()) {
+    if (EmptyStack(2)) {
         return;
     }
 
-    Value Right = Calc.back();
+    Value Right = std::move(Calc.back());
     Calc.pop_back();
 
-    Value Left = Calc.back();
+    Value Left = std::move(Calc.back());
     Calc.pop_back();
     
-    if (!TypesMatch(Left.index(), Right.index())) {
-        ErLogs.PushError("", "types don't match", 2);        
+    if (Left.IsDouble() && Right.IsDouble()) {
+        Calc.push_back(Left.AsDouble() != Right.AsDouble());
         return;
     }
 
-    if (Right.index() == doub && Left.index() == doub){
-        Right = (std::get<double>(Left) != std::get<double>(Right));
-        Calc.push_back(Right);
-        return;
+    Value Result;
+    if (IneqValues(Left, Right, Result)) {
+        Calc.push_back(std::move(Result));
     }
-    if (Right.index() == str){
-        Right = std::get<std::string>(Left) != std::get<std::string>(Right);
-        Calc.push_back(Right);
-        return;
-    }
-    if (Right.index() == doub && Right.index() == boo){
-        Right = std::get<double>(Left) != std::get<bool>(Right);
-        Calc.push_back(Right);
-        return;
-    }
-    if (Right.index() == boo && Right.index() == doub){
-        Right = std::get<bool>(Left) != std::get<double>(Right);
-        Calc.push_back(Right);
-        return;
-    }
-    if (Right.index() == boo && Right.index() == boo){
-        Right = std::get<bool>(Left) != std::get<bool>(Right);
-        Calc.push_back(Right);
-        return;
-    }
-    return;
 }
 
 // double > double
 // bool > bool
 void Calculus::grData() {
-    if (EmptyStack()) {
+    if (EmptyStack(2)) {
         return;
     }
 
-    Value Right = Calc.back();
+    Value Right = std::move(Calc.back());
     Calc.pop_back();
 
-    Value Left = Calc.back();
+    Value Left = std::move(Calc.back());
     Calc.pop_back();
     
-    if (!TypesMatch(Left.index(), Right.index())) {
-        ErLogs.PushError("", "types don't match", 2);        
-        return;
-    }
-    if(Right.index() == str) {
-        ErLogs.PushError("", "operation not permited on strings", 2);        
+    if (Left.IsDouble() && Right.IsDouble()) {
+        Calc.push_back(Left.AsDouble() > Right.AsDouble());
         return;
     }
 
-    if (Right.index() == doub && Left.index() == doub){
-        Right = (std::get<double>(Left) > std::get<double>(Right));
-        Calc.push_back(Right);
-        return;
+    Value Result;
+    if (GrValues(Left, Right, Result)) {
+        Calc.push_back(std::move(Result));
     }
-    if (Right.index() == boo && Right.index() == boo){
-        Right = std::get<bool>(Left) > std::get<bool>(Right);
-        Calc.push_back(Right);
-        return;
-    }
-    return;
 }
 
 // double < double
 // bool < bool
 void Calculus::lsData() {
-    if (EmptyStack()) {
+    if (EmptyStack(2)) {
         return;
     }
 
-    Value Right = Calc.back();
+    Value Right = std::move(Calc.back());
     Calc.pop_back();
 
-    Value Left = Calc.back();
+    Value Left = std::move(Calc.back());
     Calc.pop_back();
     
-    if (!TypesMatch(Left.index(), Right.index())) {
-        ErLogs.PushError("", "types don't match", 2);        
-        return;
-    }
-    if(Right.index() == str) {
-        ErLogs.PushError("", "operation not permited on strings", 2);        
+    if (Left.IsDouble() && Right.IsDouble()) {
+        Calc.push_back(Left.AsDouble() < Right.AsDouble());
         return;
     }
 
-    if (Right.index() == doub && Left.index() == doub){
-        Right = std::get<double>(Left) < std::get<double>(Right);
-        Calc.push_back(Right);
-        return;
+    Value Result;
+    if (LsValues(Left, Right, Result)) {
+        Calc.push_back(std::move(Result));
     }
-    if (Right.index() == boo && Right.index() == boo){
-        Right = std::get<bool>(Left) < std::get<bool>(Right);
-        Calc.push_back(Right);
-        return;
-    }
-    return;
 }
 
 // double >= double
 // bool >= bool
 void Calculus::greqData() {
-    if (EmptyStack()) {
+    if (EmptyStack(2)) {
         return;
     }
 
-    Value Right = Calc.back();
+    Value Right = std::move(Calc.back());
     Calc.pop_back();
 
-    Value Left = Calc.back();
+    Value Left = std::move(Calc.back());
     Calc.pop_back();
     
-    if (!TypesMatch(Left.index(), Right.index()))
-    {
-        ErLogs.PushError("", "types don't match", 2);        
-        return;
-    }
-    if(Right.index() == str) {
-        ErLogs.PushError("", "operation not permited on strings", 2);        
+    if (Left.IsDouble() && Right.IsDouble()) {
+        Calc.push_back(Left.AsDouble() >= Right.AsDouble());
         return;
     }
 
-    if (Right.index() == doub && Left.index() == doub){
-        Right = (std::get<double>(Left) >= std::get<double>(Right));
-        Calc.push_back(Right);
-        return;
-    }
-    if (Right.index() == str){
-        Right = std::get<std::string>(Left) >= std::get<std::string>(Right);
-        Calc.push_back(Right);
-        return;
+    Value Result;
+    if (GreqValues(Left, Right, Result)) {
+        Calc.push_back(std::move(Result));
     }
-    if (Right.index() == boo && Right.index() == boo){
-        Right = std::get<bool>(Left) >= std::get<bool>(Right);
-        Calc.push_back(Right);
-        return;
-    }
-    return;
 }
 
 // double <= double
 // bool <= bool
 void Calculus::lseqData() {
-    if (EmptyStack()) {
+    if (EmptyStack(2)) {
         return;
     }
 
-    Value Right = Calc.back();
+    Value Right = std::move(Calc.back());
     Calc.pop_back();
 
-    Value Left = Calc.back();
+    Value Left = std::move(Calc.back());
     Calc.pop_back();
     
-    if (!TypesMatch(Left.index(), Right.index())) 
-    {
-        ErLogs.PushError("", "types don't match", 2);        
+    if (Left.IsDouble() && Right.IsDouble()) {
+        Calc.push_back(Left.AsDouble() <= Right.AsDouble());
         return;
     }
-    if(Right.index() == str) {
-        ErLogs.PushError("", "operation not permited on strings", 2);        
+
+    Value Result;
+    if (LseqValues(Left, Right, Result)) {
+        Calc.push_back(std::move(Result));
+    }
+}
+
+// string + string, quickened
+int Calculus::addstrData() {
+    size_t size = Calc.size();
+    if (size < 2 || !Calc[size - 2].IsString() || !Calc[size - 1].IsString()) {
+        return 0;
+    }
+    Calc[size - 2] = ConcatString(Calc[size - 2].AsString(),
+                                  Calc[size - 1].AsString());
+    Calc.pop_back();
+    return 1;
+}
+
+// string == string and string != string, quickened
+int Calculus::eqstrData(bool Equal) {
+    size_t size = Calc.size();
+    if (size < 2 || !Calc[size - 2].IsString() || !Calc[size - 1].IsString()) {
+        return 0;
+    }
+    Calc[size - 2] = EqualStrings(Calc[size - 2].AsString(),
+                                  Calc[size - 1].AsString()) == Equal;
+    Calc.pop_back();
+    return 1;
+}
+
+// - double
+void Calculus::invsigData() {
+    if (EmptyStack()) {
         return;
     }
 
-    if (Right.index() == doub){
-        Right = (std::get<double>(Left) <= std::get<double>(Right));
-        Calc.push_back(Right);
+    Value Expr = std::move(Calc.back());
+    Calc.pop_back();
+   
+    if (Expr.IsDouble()) {
+        Calc.push_back(-Expr.AsDouble());
         return;
     }
-    if (Right.index() == boo){
-        Right = std::get<bool>(Left) <= std::get<bool>(Right);
-        Calc.push_back(Right);
+
+    Value Result;
+    if (InvsigValue(Expr, Result)) {
+        Calc.push_back(std::move(Result));
+    }
+}
+
+// ! double
+// ! bool
+void Calculus::negData() {
+    if (EmptyStack()) {
         return;
     }
-    return;
+
+    Value Expr = std::move(Calc.back());
+    Calc.pop_back();
+    
+    Value Result;
+    if (NegValue(Expr, Result)) {
+        Calc.push_back(std::move(Result));
+    }
 }
 
 // Built-in Print
@@ -460,157 +616,99 @@ void Calculus::printData() {
         return;
     }
 
-    Value tmp = Calc.back();
+    Value tmp = std::move(Calc.back());
     Calc.pop_back();
     
-    switch(tmp.index()) {
-        case doub: {
-            printf("%g\n", std::get<double>(tmp));
-            break;
-        }
-        case boo: {
-            if(std::get<bool>(tmp)) {
-                printf("true\n");
-            } else {
-                printf("false\n");
-            }
-            break;
-        }
-        case str: {
-            printf("'%s'\n", std::get<std::string>(tmp).c_str());
-            break;
-        }
-        default: {
-            printf("null\n");
-            break;
-        }
-    }
+    PrintValue(tmp);
 }
 
-// Store Variable and it's offset
-void Calculus::stvarData(int offset) {
+// The table of globals has a slot for every global declaration
+void Calculus::InitGlobals(int size) {
+    Globals.resize(size);
+}
+
+// Store Variable in its slot on the current frame
+void Calculus::stvarData(int slot) {
     if (EmptyStack()) {
         return;
     }
     
-    Value var = Calc.back();
+    Locals[Base + slot] = std::move(Calc.back());
     Calc.pop_back();
 
-    CobaluStack.ChangeValue(var, offset);
-
     return;
 }
 
 // Return the value of the variable
-void Calculus::retvarData(int offset) {
-
-    Bytecode byte = CobaluStack.Return(offset);
-    byte = CobaluStack.Return(byte.offset);
-    Calc.push_back(byte.data);
+void Calculus::retvarData(int slot) {
+    PushCalc(Locals[Base + slot]);
 }
 
-// Evaluate condition and jumps on the stack accordingly
-void Calculus::evalCondition() {
+// Store Variable in its slot on the globals
+void Calculus::stglobData(int slot) {
     if (EmptyStack()) {
         return;
     }
 
-    Value cond = Calc.back();
+    Globals[slot] = std::move(Calc.back());
     Calc.pop_back();
 
-    if (cond.index() == str) {
-        ErLogs.PushError(std::get<std::string>(cond), 
-            "string type is not supported in conditions", 2);
-        return;
-    }
+    return;
+}
 
-    Bytecode byte = CobaluStack.Return(-1);
+// Return the value of the global variable
+void Calculus::retglobData(int slot) {
+    PushCalc(Globals[slot]);
+}
 
-    switch (cond.index()) {
-        case doub: {
-            if(!std::get<double>(cond)) {
-                CobaluStack.Goto(CobaluStack.SP() + byte.offset);
-                return;
-            }
-            return;
-        }
-        case boo: {
-            if(!std::get<bool>(cond)) {
-                CobaluStack.Goto(CobaluStack.SP() + byte.offset);
-                return;
-            }
-            return;
-        }
-        default: {
-            CobaluStack.Goto(CobaluStack.SP() + byte.offset);
-            return;
-        }
+// Evaluate condition, returns 1 if the condition failed and the VM needs to 
+// jump
+int Calculus::evalCondition() {
+    if (EmptyStack()) {
+        return 0;
     }
-    return;
+
+    Value cond = std::move(Calc.back());
+    Calc.pop_back();
+
+    return FalseValue(cond);
 }
 
-// Generates the function in the end of the stack or set it to generate
-void Calculus::funcGen(int offset) {
-    Bytecode byte = CobaluStack.Return(offset);
+// Opens a new frame for the function. Returns where the execution continues
+int Calculus::callFunc(int index, int ret) {
+    const Function& func = CobaluStack.Func(index);
 
-    // In the first interaction we just write the function
-    if (!std::get<double>(byte.data)) {
-        while(true) {
-            CobaluStack.Advance();
-            Bytecode tmp = CobaluStack.Return(-1);
-            if (tmp.inst == funcend) {
-               CobaluStack.ChangeValue(1.0, offset);
-               return;
-            }
-        }
+    if (Frames.size() >= (size_t)CobaluOpts.CallLimit) {
+        LimitError("too many nested calls, the limit is", 
+                   CobaluOpts.CallLimit);
     }
 
-    // Map for reassign offset
-    std::unordered_map<int, int> reasoff;
+    Frames.push_back({ret, Base});
+    Base = Locals.size();
+    Locals.resize(Base + func.Locals);
 
-    // Saves the current place so we can return to it
-    int fp = CobaluStack.Size() + 1;
-    CobaluStack.Goto(offset);
-    while (true) {
-        Bytecode byte = CobaluStack.Return(-1);
-        if (byte.inst == funcend) {
-            CobaluStack.Push(byte);
-            break;
-        }
-        // Reassign the offset of the variables
-        if (byte.inst == varst) {
-            if(byte.offset == CobaluStack.SP()) {
-                reasoff[byte.offset] = CobaluStack.Size();
-                byte.offset = CobaluStack.Size();
-            } else {
-                byte.offset = reasoff[byte.offset];
-            }
-        }
-        if (byte.inst == varrt) {
-            byte.offset = reasoff[byte.offset];
-        }
-        CobaluStack.Push(byte);
-        CobaluStack.Advance();
-    }
-    // Return to the start of the generate function and execute it
-    CobaluStack.Goto(fp);
-    CodeExec(CobaluStack.Size()-1);
+    return func.Entry;
 }
 
-// Does the call to the function
-void Calculus::callFunc(int offset) {
-    Bytecode byte = CobaluStack.Return(offset);
+// Discards the frame of the function. Returns where the execution continues
+int Calculus::retfuncData() {
+    CallFrame frame = Frames.back();
+    Frames.pop_back();
 
-    this->funcGen(byte.offset);
+    Locals.resize(Base);
+    Base = frame.Base;
 
-    //Calc.pop_back();
+    return frame.Return;
+}
 
-    CobaluStack.Goto(offset);
+// Replaces the frame of the function by the one of the function it calls on
+// its return, that returns to the same place. The locals start empty like 
+// on a new frame
+int Calculus::tailFunc(int index) {
+    const Function& func = CobaluStack.Func(index);
 
-    return;
-}
+    Locals.resize(Base);
+    Locals.resize(Base + func.Locals);
 
-// Returns to the execution of the stack
-void Calculus::retfuncData(int currentoff) {
-    CobaluStack.SetRet(1);
+    return func.Entry;
 }
@@ -0,0 +1,176 @@
+#include "Headers/error_log.h"
+#include "Headers/vcm.h"
+#include <map>
+
+///////////////////////////////////////////////////////////////////////////////
+////////////                   SUPERINSTRUCTIONS                   ////////////
+///////////////////////////////////////////////////////////////////////////////
+
+// Words taken by a instruction, the superinstructions take all the sequence
+int Length(Instruction inst) {
+    switch (inst) {
+        case glbcmp: case varcmp: case glbarith: case vararith: {
+            return 4;
+        }
+        default: {
+            return 1;
+        }
+    }
+}
+
+bool IsLoad(Instruction inst) {
+    return inst == ndoubl || inst == glbrt || inst == varrt;
+}
+
+bool IsCompare(Instruction inst) {
+    return (inst >= eqD && inst <= lseqD) || (inst >= eqN && inst <= lseqN);
+}
+
+bool IsArith(Instruction inst) {
+    return (inst >= addD && inst <= divD) || (inst >= addN && inst <= divN);
+}
+
+// The superinstruction that can take the sequence starting at the word, or
+// the instruction of the word if there is none
+Instruction Fusion(const Bytecode* code, int pos, int size) {
+    Instruction first = code[pos].inst;
+
+    if ((first != glbrt && first != varrt) || pos + 3 >= size ||
+        !IsLoad(code[pos + 1].inst)) {
+        return first;
+    }
+
+    // load, load, comparasion, conditional jump
+    Instruction jump = code[pos + 3].inst;
+    if (IsCompare(code[pos + 2].inst) && (jump == jmpf || jump == jmpt)) {
+        return first == glbrt ? glbcmp : varcmp;
+    }
+
+    // load, load, arithmetic, store
+    Instruction store = code[pos + 3].inst;
+    if (IsArith(code[pos + 2].inst) && (store == glbst || store == varst)) {
+        return first == glbrt ? glbarith : vararith;
+    }
+    return first;
+}
+
+// Replaces the common sequences of the code by superinstructions. The words
+// of the sequence stay as they are, so no offset changes. A sequence with a
+// jump landing inside it can't be fused, the jump would skip the start
+void FuseInstructions() {
+    const Bytecode* code = CobaluStack.Code();
+    int size = CobaluStack.Size();
+    std::vector<bool> Landed = CobaluStack.Landings();
+
+    for (int pos=0; pos < size; pos++) {
+        Instruction fused = Fusion(code, pos, size);
+        if (fused == code[pos].inst) {
+            continue;
+        }
+
+        int end = pos + Length(fused);
+        if (std::find(Landed.begin() + pos + 1, Landed.begin() + end, true) != 
+            Landed.begin() + end) {
+            continue;
+        }
+
+        Bytecode byte = code[pos];
+        byte.inst = fused;
+        CobaluStack.Insert(byte, pos);
+        pos = end - 1;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+////////////                       PROFILER                        ////////////
+///////////////////////////////////////////////////////////////////////////////
+
+// Instructions after which the execution may not continue in the next one
+bool Transfer(Instruction inst) {
+    switch (inst) {
+        case jmp: case jmpf: case jmpt: case funcsta: case funcend: 
+        case callfunc: case retrn: case tailcall: case glbcmp: case varcmp: case endstk: {
+            return true;
+        }
+        default: {
+            return false;
+        }
+    }
+}
+
+// The sequences of straight code, with no jump landing inside them, weighted
+// by the times they run. The hottest are the ones worth a superinstruction
+void ProfileReport() {
+    const Bytecode* code = CobaluStack.Code();
+    int size = CobaluStack.Size();
+    std::vector<bool> Landed = CobaluStack.Landings();
+
+    long long Total = 0;
+    std::map<std::string, long long> Seqs;
+    // Sites, executions and dispatches saved of the superinstructions
+    std::map<std::string, std::vector<long long>> Fused;
+    for (int i=0; i < size; i++) {
+        Total += Hits[i];
+        int len = Length(code[i].inst);
+        if (len > 1) {
+            // A execution that falls back to the first instruction continues
+            // on the next word and saves nothing
+            long long Fast = Hits[i] - Hits[i + 1];
+            std::vector<long long>& Stats = Fused[inst_to_str[code[i].inst]];
+            Stats.resize(3);
+            Stats[0]++;
+            Stats[1] += Hits[i];
+            Stats[2] += Fast * (len - 1);
+        }
+        if (!Hits[i]) {
+            continue;
+        }
+
+        std::string Name = inst_to_str[code[i].inst];
+        for (int n=1, pos=i; n < 4 && !Transfer(code[pos].inst); n++) {
+            pos += Length(code[pos].inst);
+            if (pos >= size || Landed[pos]) {
+                break;
+            }
+            Name += " " + inst_to_str[code[pos].inst];
+            Seqs[Name] += Hits[i] * n; // dispatches saved if fused
+        }
+    }
+
+    // Operations that ended quickened
+    std::map<std::string, int> Quick;
+    for (int i=0; i < size; i++) {
+        if (code[i].inst >= addnum && code[i].inst <= lseqnum) {
+            Quick[inst_to_str[code[i].inst]]++;
+        }
+    }
+
+    std::vector<std::pair<long long, std::string>> Hot;
+    for (auto& [Name, Saved] : Seqs) {
+        Hot.push_back({Saved, Name});
+    }
+    std::sort(Hot.rbegin(), Hot.rend());
+
+    fprintf(stderr, "==== profile: %lld instructions executed ====\n", Total);
+    fprintf(stderr, "%-16s %8s %14s %16s\n", "fusions", "sites", "executions",
+            "dispatches saved");
+    for (auto& [Name, Stats] : Fused) {
+        fprintf(stderr, "  %-14s %8lld %14lld %16lld\n", Name.c_str(), 
+                Stats[0], Stats[1], Stats[2]);
+    }
+    fprintf(stderr, "%-16s %8s\n", "peephole", "rewrites");
+    for (auto& [Name, Times] : Peepholes) {
+        fprintf(stderr, "  %-22s %8d\n", Name.c_str(), Times);
+    }
+    fprintf(stderr, "  %-22s %8d\n", "instructions removed", Eliminated);
+    fprintf(stderr, "%-16s %8s\n", "quickened", "sites");
+    for (auto& [Name, Sites] : Quick) {
+        fprintf(stderr, "  %-14s %8d\n", Name.c_str(), Sites);
+    }
+    fprintf(stderr, "  de-optimizations %6lld\n", Deopts);
+    fprintf(stderr, "%-40s %16s\n", "hot sequences", "dispatches saved");
+    for (size_t i=0; i < Hot.size() && i < 12; i++) {
+        fprintf(stderr, "  %-38s %16lld\n", Hot[i].second.c_str(), 
+                Hot[i].first);
+    }
+}
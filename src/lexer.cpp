@@ -1,307 +1,290 @@
 #include "Headers/error_log.h"
 #include "Headers/lexer.h"
 
-// Buffers
-std::string Identifier;
-std::string StringBuffer;
-double DoubleBuffer;
+// Last token read
+Span TokenSpan;
 
-// Reads file char by char
-char Buffer = ' ';
+// Source being read and the position of the next char in it
+const char* SourceBegin = nullptr;
+const char* Cursor = nullptr;
+const char* SourceEnd = nullptr;
 
-void WhiteSpaceRM() {
-    while(isspace(Buffer)) {
-        FileInput.get(Buffer);
+// Line of the cursor and where it starts
+int Line = 1;
+const char* LineStart = nullptr;
 
-        // Add lines
-        if (Buffer == '\n') {
-            ErLogs.AddLine();
-        }
+void LexerInput(const char* Begin, const char* End) {
+    SourceBegin = Begin;
+    Cursor = Begin;
+    SourceEnd = End;
+    Line = 1;
+    LineStart = Begin;
+}
 
-        if (FileInput.eof()) { 
-            Buffer = -1; 
-            break; 
-        }
+std::string_view TokenText() {
+    const char* Start = SourceBegin + TokenSpan.Offset;
+    if (TokenSpan.Kind == TOKEN_STRING) {
+        return {Start + 1, (size_t)TokenSpan.Length - 2}; // without '"'
     }
+    return {Start, (size_t)TokenSpan.Length};
 }
 
-// Compare strings
-Token checkId(int lenght, char Comp[], Token type) 
-{
-    char Peek[lenght];
-    for (int i=0; i <= lenght; i++) {
-        FileInput.get(Buffer);
-        if (!isalpha(Buffer)) {
-            break;
-        }
-        Peek[i] = Buffer;
-        Identifier += Buffer;
-    }
+StrObj* TokenName() {
+    return TokenSpan.Symbol ? TokenSpan.Symbol : Intern(TokenText());
+}
 
-    if(memcmp(Comp, Peek, lenght) == 0) {
-        return type;
+double TokenNumber() {
+    // The source isn't terminated, strtod needs a copy. The numbers are
+    // short, one that isn't is read from the heap
+    char Digits[64];
+    std::string Long;
+    const char* Number = Digits;
+    std::string_view Text = TokenText();
+    if (Text.size() < sizeof(Digits)) {
+        memcpy(Digits, Text.data(), Text.size());
+        Digits[Text.size()] = '\0';
+    } else {
+        Long = Text;
+        Number = Long.c_str();
     }
+    return strtod(Number, nullptr);
+}
 
-    // If fails saves the identifier
-    while (isalnum(Buffer) || Buffer ==  '_') {
-            Identifier += Buffer;
-            FileInput.get(Buffer);
-    }
-    return TOKEN_ID;
+// Char at the position, or -1 past the end of the source
+inline int Peek(const char* At) {
+    return At < SourceEnd ? (unsigned char)*At : -1;
 }
 
-int Tokenizer() {     
-    // Remove Whitespaces 
-    WhiteSpaceRM();
-    FileInput.eof();
+inline bool isIdChar(int Char) {
+    return isalnum(Char) || Char == '_';
+}
 
-    // Ignore Comments
-    // #.*
-    while (Buffer == '#') {
-        FileInput.get(Buffer);
+///////////////////////////////////////////////////////////////////////////////
+////////////                       KEYWORDS                        ////////////
+///////////////////////////////////////////////////////////////////////////////
+
+// The keywords are found with a perfect hash of the first char, the last
+// char and the lenght of the identifier, that are different for each of
+// them. The multiplier of the hash is searched when compiling, so a
+// identifier is classified with one hash and one compare
+
+struct KeywordEntry {
+    const char* Name = nullptr;
+    long Len = 0;
+    Token Type = TOKEN_ID;
+};
+
+constexpr KeywordEntry Keywords[] = {
+    {"if", 2, TOKEN_IF}, {"else", 4, TOKEN_ELSE}, {"for", 3, TOKEN_FOR},
+    {"while", 5, TOKEN_WHILE}, {"break", 5, TOKEN_BREAK},
+    {"var", 3, TOKEN_VAR}, {"func", 4, TOKEN_FUNC},
+    {"return", 6, TOKEN_RET}, {"print", 5, TOKEN_PRINT},
+    {"true", 4, TOKEN_TRUE}, {"false", 5, TOKEN_FALSE},
+    {"null", 4, TOKEN_NULL}, {"class", 5, TOKEN_CLASS},
+    {"super", 5, TOKEN_SUPER}, {"this", 4, TOKEN_THIS},
+};
 
-        while (Buffer != '\r' &&  Buffer != '\n' && !FileInput.eof()) {
-            FileInput.get(Buffer);
+constexpr int KeywordBits = 6;
+constexpr long KeywordMin = 2;
+constexpr long KeywordMax = 6;
+
+constexpr unsigned KeywordHash(uint32_t Seed, const char* Name, long Len) {
+    uint32_t Key = (unsigned char)Name[0] << 16 |
+                   (unsigned char)Name[Len-1] << 8 | Len;
+    return (Key * Seed) >> (32 - KeywordBits);
+}
+
+// First multiplier that puts each keyword in a slot of its own
+constexpr uint32_t KeywordSeed() {
+    for (uint32_t Seed = 0x9e3779b1;; Seed += 2) {
+        bool Used[1 << KeywordBits] = {};
+        bool Perfect = true;
+        for (const KeywordEntry& Word : Keywords) {
+            unsigned Slot = KeywordHash(Seed, Word.Name, Word.Len);
+            Perfect = Perfect && !Used[Slot];
+            Used[Slot] = true;
+        }
+        if (Perfect) {
+            return Seed;
         }
-        
-        WhiteSpaceRM();
-        FileInput.eof();
     }
+}
 
-    // Numbers
-    // [0-9]+[.][0-9]*
-    if (isdigit(Buffer)) {
-        std::string NumStr;
-        NumStr += Buffer;
-        FileInput.get(Buffer);
-
-        while (isdigit(Buffer)) {
-            NumStr += Buffer;
-            FileInput.get(Buffer);
-        }
-        if (Buffer == '.') {
-            NumStr += Buffer;
-            FileInput.get(Buffer);
-            while(isdigit(Buffer)) {
-                NumStr += Buffer;
-                FileInput.get(Buffer);
-            }
+constexpr uint32_t KeywordMul = KeywordSeed();
 
-            DoubleBuffer = strtod(NumStr.c_str(), nullptr);
-            return TOKEN_DOUBLE;
-        }
+struct KeywordTable {
+    KeywordEntry Slots[1 << KeywordBits];
 
-        // Modify to int
-        DoubleBuffer = strtod(NumStr.c_str(), nullptr);
-        return TOKEN_DOUBLE;
-    }
-    
-    // Strings
-    // ".*"
-    if (Buffer == '"') {
-        StringBuffer.clear();
-        FileInput.get(Buffer);
-        while (isprint(Buffer)) {
-            if (Buffer == '"') {
-                FileInput.get(Buffer);
-                return TOKEN_STRING;
-            }
-            StringBuffer += Buffer;
-            FileInput.get(Buffer);
+    constexpr KeywordTable() {
+        for (const KeywordEntry& Word : Keywords) {
+            Slots[KeywordHash(KeywordMul, Word.Name, Word.Len)] = Word;
         }
     }
+};
 
-    // Operations
-    // [+-/*]
-    if (Buffer == '+') {
-        FileInput.get(Buffer);
-        return TOKEN_PLUS;
-    }
-    if (Buffer == '-') {
-        FileInput.get(Buffer);
-        return TOKEN_MINUS;
-    }
-    if (Buffer == '/') {
-        FileInput.get(Buffer);
-        return TOKEN_DIV;
+constexpr KeywordTable KeywordSlots;
+
+// Identifier or keyword, the identifier is in [Start, Start+Len)
+int Keyword(const char* Start, long Len) {
+    if (Len < KeywordMin || Len > KeywordMax) {
+        return TOKEN_ID;
     }
-    if (Buffer == '*') {
-        FileInput.get(Buffer);
-        return TOKEN_MUL;
+    unsigned Slot = KeywordHash(KeywordMul, Start, Len);
+    const KeywordEntry& Word = KeywordSlots.Slots[Slot];
+    if (Word.Len == Len && memcmp(Word.Name, Start, Len) == 0) {
+        return Word.Type;
     }
+    return TOKEN_ID;
+}
 
-    // Atribution
-    // =
-    if (Buffer == '=') {
-        FileInput.get(Buffer);
-        if (Buffer != '=') {
-            return TOKEN_ATR;
+// Reads the next token, that starts at Start and ends at the cursor
+int Scan(const char*& Start) {
+    // Remove Whitespaces and Comments
+    // #.*
+    while (Cursor < SourceEnd) {
+        if (isspace((unsigned char)*Cursor)) {
+            // Add lines
+            if (*Cursor == '\n') {
+                Line++;
+                LineStart = Cursor + 1;
+            }
+            Cursor++;
+        } else if (*Cursor == '#') {
+            while (Cursor < SourceEnd && *Cursor != '\r' && *Cursor != '\n') {
+                Cursor++;
+            }
+        } else {
+            break;
         }
     }
 
-    // Comparasion
-    // [><=](?=)
-    if (Buffer == '=') {
-        FileInput.get(Buffer);
-        return TOKEN_EQUAL; // '=='
-    }
-    if (Buffer == '<') {
-        FileInput.get(Buffer);
-        if (Buffer == '=') {
-            FileInput.get(Buffer);
-            return TOKEN_LESSEQ; // '<='
-        }
-        return TOKEN_LESS; // '<'
-    }
-    if (Buffer == '>') {
-        FileInput.get(Buffer);
-        if (Buffer == '=') { 
-            FileInput.get(Buffer);
-            return TOKEN_GREATEQ; // '>='
-        }
-        return TOKEN_GREATER; // '>'
+    Start = Cursor;
+    if (Cursor == SourceEnd) {
+        return TOKEN_EOF;
     }
+    int Char = (unsigned char)*Cursor++;
 
-    // Unary
-    // !(=)?
-    if (Buffer == '!') {
-        FileInput.get(Buffer);
-        if (Buffer == '=') {
-            // A wild comparasion appears!
-            FileInput.get(Buffer);
-            return TOKEN_INEQUAL; // '!='
+    // Numbers
+    // [0-9]+[.][0-9]*
+    if (isdigit(Char)) {
+        while (isdigit(Peek(Cursor))) {
+            Cursor++;
         }
-        return TOKEN_NOT; 
-    }
-    
-    // Logical
-    // (&&) | (||)
-    if (Buffer == '&') {
-        FileInput.get(Buffer);
-        if (Buffer == '&') {
-            FileInput.get(Buffer);
-            return TOKEN_AND;
+        if (Peek(Cursor) == '.') {
+            Cursor++;
+            while (isdigit(Peek(Cursor))) {
+                Cursor++;
+            }
         }
-        
-        // For now there is no use for a single &
-        int Literal = Buffer;
-        FileInput.get(Buffer);
-        return Literal;
+        return TOKEN_DOUBLE;
     }
-    if (Buffer == '|') {
-        FileInput.get(Buffer);
-        if (Buffer == '|') {
-            FileInput.get(Buffer);
-            return TOKEN_OR;
+
+    // Verify if is a identifier
+    // [A-Za-z]+[A-Za-z0-9_]*
+    if (isalpha(Char)) {
+        while (isIdChar(Peek(Cursor))) {
+            Cursor++;
         }
-        // For now there is no use for a single |
-        int Literal = Buffer;
-        FileInput.get(Buffer);
-        return Literal;
+        return Keyword(Start, Cursor - Start);
     }
 
-    // Verify if is a identifier
-    // [A-Za-z]+[A-Za-z0-9_]* 
-    if (isalpha(Buffer)) {
-        Identifier.clear();
-        switch(Buffer) {
-            case 'i': {
-                Identifier += Buffer;
-                char Comp[] = "f";
-                return checkId(1, Comp, TOKEN_IF);
-            }
-            case 'p': {
-                Identifier += Buffer;
-                char Comp[] = "rint";
-                return checkId(4, Comp, TOKEN_PRINT);
-            }
-            case 'e': {
-                Identifier += Buffer;
-                char Comp[] = "lse";
-                return checkId(3, Comp, TOKEN_ELSE);
+    switch (Char) {
+        // Strings
+        // ".*"
+        case '"': {
+            const char* End = Cursor;
+            while (isprint(Peek(End)) && *End != '"') {
+                End++;
             }
-            case 'v': {
-                Identifier += Buffer;
-                char Comp[] = "ar";
-                return checkId(2, Comp, TOKEN_VAR);
-            }
-            case 'b': {
-                Identifier += Buffer;
-                char Comp[] = "reak";
-                return checkId(4, Comp, TOKEN_BREAK);
-            }
-            case 'n': {
-                Identifier += Buffer;
-                char Comp[] = "ull";
-                return checkId(3, Comp, TOKEN_NULL);
-            }
-            case 'w': {
-                Identifier += Buffer;
-                char Comp[] = "hile";
-                return checkId(4, Comp, TOKEN_WHILE);
+            // Without the closing quote the char that stops it is a literal
+            if (Peek(End) != '"') {
+                Start = Cursor = End;
+                if (Cursor == SourceEnd) {
+                    return TOKEN_EOF;
+                }
+                return (unsigned char)*Cursor++;
             }
-            case 'c': {
-                Identifier += Buffer;
-                char Comp[] = "lass";
-                return checkId(4, Comp, TOKEN_CLASS);
+            Cursor = End + 1;
+            return TOKEN_STRING;
+        }
+
+        // Operations
+        // [+-/*]
+        case '+': return TOKEN_PLUS;
+        case '-': return TOKEN_MINUS;
+        case '/': return TOKEN_DIV;
+        case '*': return TOKEN_MUL;
+
+        // Atribution and Comparasion
+        // [><=!](?=)
+        case '=': {
+            if (Peek(Cursor) == '=') {
+                Cursor++;
+                return TOKEN_EQUAL; // '=='
             }
-            case 's': {
-                Identifier += Buffer;
-                char Comp[] = "uper";
-                return checkId(4, Comp, TOKEN_SUPER);
+            return TOKEN_ATR;
+        }
+        case '<': {
+            if (Peek(Cursor) == '=') {
+                Cursor++;
+                return TOKEN_LESSEQ; // '<='
             }
-            case 'r': {
-                Identifier += Buffer;
-                char Comp[] = "eturn";
-                return checkId(5, Comp, TOKEN_RET);
+            return TOKEN_LESS; // '<'
+        }
+        case '>': {
+            if (Peek(Cursor) == '=') {
+                Cursor++;
+                return TOKEN_GREATEQ; // '>='
             }
-            case 't': {
-                Identifier += Buffer;
-                FileInput.get(Buffer);
-                switch(Buffer) {
-                    case 'r': {
-                        Identifier += Buffer;
-                        char Comp[] = "ue";
-                        return checkId(2, Comp, TOKEN_TRUE);
-                    }
-                    case 'h': {
-                        Identifier += Buffer;
-                        char Comp[] = "is";
-                        return checkId(2, Comp, TOKEN_THIS);
-                    }
-                }
+            return TOKEN_GREATER; // '>'
+        }
+
+        // Unary
+        // !(=)?
+        case '!': {
+            if (Peek(Cursor) == '=') {
+                // A wild comparasion appears!
+                Cursor++;
+                return TOKEN_INEQUAL; // '!='
             }
-            case 'f': {
-                Identifier += Buffer;
-                FileInput.get(Buffer);
-                switch(Buffer) {
-                    case 'a': {
-                        Identifier += Buffer;
-                        char Comp[] = "lse";
-                        return checkId(3, Comp, TOKEN_FALSE);
-                    }
-                    case 'u': {
-                        Identifier += Buffer;
-                        char Comp[] = "nc";
-                        return checkId(2, Comp, TOKEN_FUNC);
-                    }
-                    case 'o': {
-                        Identifier += Buffer;
-                        char Comp[] = "r";
-                        return checkId(1, Comp, TOKEN_FOR);
-                    }
-                }
+            return TOKEN_NOT;
+        }
+
+        // Logical
+        // (&&) | (||)
+        case '&': {
+            if (Peek(Cursor) == '&') {
+                Cursor++;
+                return TOKEN_AND;
             }
+            // For now there is no use for a single &
+            break;
         }
-        while (isalnum(Buffer) || Buffer == '_') {
-            Identifier += Buffer;
-            FileInput.get(Buffer);
+        case '|': {
+            if (Peek(Cursor) == '|') {
+                Cursor++;
+                return TOKEN_OR;
+            }
+            // For now there is no use for a single |
+            break;
         }
-        return TOKEN_ID;
     }
 
     // If nothing else worked, return a literal
-    int Literal = Buffer;
-    FileInput.get(Buffer);
-    return Literal;
+    return Char;
+}
+
+int Tokenizer() {
+    const char* Start;
+    int Kind = Scan(Start);
+    TokenSpan.Kind = Kind;
+    TokenSpan.Offset = Start - SourceBegin;
+    TokenSpan.Length = Cursor - Start;
+    TokenSpan.Line = Line;
+    TokenSpan.Column = Start - LineStart + 1;
+    TokenSpan.Symbol = nullptr;
+    if (Kind == TOKEN_ID) {
+        TokenSpan.Symbol = Intern({Start, (size_t)(Cursor - Start)});
+    }
+    return Kind;
 }
@@ -1,25 +1,157 @@
 #include "Headers/global.h"
 #include "Headers/error_log.h"
+#include "Headers/lexer.h"
 #include "Headers/vcm.h"
 
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 // Definition of the global class for errors
 Logging ErLogs;
 
-// Global File
-std::fstream FileInput;
+// Options of the command line
+Options CobaluOpts;
+
+void Usage() {
+    printf("Usage: cobalu [options] <file>\n"
+           "Options:\n"
+           "  --stack <n>   max number of values on the stack of execution\n"
+           "  --calls <n>   max number of nested function calls\n"
+           "  --heap <n>    max bytes of strings, accepts k, m and g\n"
+           "  --inline <n>  max size of the functions inlined, 0 turns it off\n"
+           "  --register    run on the register machine\n"
+           "  --profile     report the hottest sequences of instructions\n"
+           "  --no-fuse     don't use superinstructions\n"
+           "  --no-opt      don't optimize the code\n"
+           "  --show-dead   print the code removed as dead\n"
+           "  --ssa         compile through the SSA form\n"
+           "  --lex         only tokenize the file and report the speed\n");
+    exit(1);
+}
+
+// Reads a positive number, with a optional k, m or g multiplier
+long ParseSize(const char* Arg) {
+    char* End;
+    errno = 0;
+    long Size = strtol(Arg, &End, 10);
+    bool Overflow = errno == ERANGE;
+
+    int Shift = 0;
+    switch (tolower(*End)) {
+        case 'k': Shift = 10; End++; break;
+        case 'm': Shift = 20; End++; break;
+        case 'g': Shift = 30; End++; break;
+    }
+    // A size that doesn't fit would wrap around to a small or negative one
+    Overflow = Overflow || Size > (LONG_MAX >> Shift);
+    if (End == Arg || *End != '\0' || Size <= 0 || Overflow) {
+        printf("Invalid size '%s'\n", Arg);
+        Usage();
+    }
+    return Size << Shift;
+}
+
+// Maps the whole file in memory, the lexer reads it from there. The mapping
+// is kept until the end of the execution
+bool LoadFile(const char* File, const char** Begin, const char** End) {
+    int Fd = open(File, O_RDONLY);
+    if (Fd < 0) {
+        return false;
+    }
+
+    struct stat Info;
+    if (fstat(Fd, &Info) < 0 || !S_ISREG(Info.st_mode)) {
+        close(Fd);
+        return false;
+    }
+
+    // A empty file can't be mapped
+    void* Source = (void*)"";
+    if (Info.st_size > 0) {
+        Source = mmap(nullptr, Info.st_size, PROT_READ, MAP_PRIVATE, Fd, 0);
+    }
+    close(Fd);
+    if (Source == MAP_FAILED) {
+        return false;
+    }
+
+    *Begin = (const char*)Source;
+    *End = *Begin + Info.st_size;
+    return true;
+}
+
+// Tokenizes all the source, the time doesn't count the load of the file
+void LexOnly(const char* Begin, const char* End) {
+    long Tokens = 0;
+    auto Start = std::chrono::steady_clock::now();
+    while (Tokenizer() != TOKEN_EOF) {
+        Tokens++;
+    }
+    auto Stop = std::chrono::steady_clock::now();
+
+    double Seconds = std::chrono::duration<double>(Stop - Start).count();
+    double Megabytes = (End - Begin) / (double)(1 << 20);
+    fprintf(stderr, "tokens: %ld\n", Tokens);
+    fprintf(stderr, "lexed: %.2f MB in %.3f ms, %.1f MB/s\n", Megabytes,
+            Seconds * 1000, Seconds > 0 ? Megabytes / Seconds : 0);
+}
 
 int main(int argc, char** argv) {
-    if (argc < 2) {
+    const char* File = nullptr;
+    for (int i=1; i < argc; i++) {
+        std::string Arg = argv[i];
+        if (Arg == "--stack" && i+1 < argc) {
+            CobaluOpts.StackLimit = ParseSize(argv[++i]);
+        } else if (Arg == "--calls" && i+1 < argc) {
+            CobaluOpts.CallLimit = ParseSize(argv[++i]);
+        } else if (Arg == "--heap" && i+1 < argc) {
+            CobaluOpts.HeapLimit = ParseSize(argv[++i]);
+        } else if (Arg == "--inline" && i+1 < argc) {
+            // Zero is not a size, but it is a valid threshold
+            Arg = argv[++i];
+            CobaluOpts.InlineSize = Arg == "0" ? 0 : ParseSize(argv[i]);
+        } else if (Arg == "--register") {
+            CobaluOpts.Register = true;
+        } else if (Arg == "--profile") {
+            CobaluOpts.Profile = true;
+        } else if (Arg == "--no-fuse") {
+            CobaluOpts.Fuse = false;
+        } else if (Arg == "--no-opt") {
+            CobaluOpts.Optimize = false;
+        } else if (Arg == "--show-dead") {
+            CobaluOpts.ShowDead = true;
+        } else if (Arg == "--ssa") {
+            CobaluOpts.Ssa = true;
+        } else if (Arg == "--lex") {
+            CobaluOpts.Lex = true;
+        } else if (Arg[0] == '-' || File) {
+            Usage();
+        } else {
+            File = argv[i];
+        }
+    }
+
+    if (!File) {
         printf("No file was provided\nExiting...\n");
         exit(1);
     }
 
-    FileInput.open(argv[1]);
-
-    if (!FileInput.is_open()) {
+    const char* Begin;
+    const char* End;
+    if (!LoadFile(File, &Begin, &End)) {
         printf("Could not load file\nExiting...\n");
         exit(1);
     }
+    LexerInput(Begin, End);
 
+    if (CobaluOpts.Lex) {
+        LexOnly(Begin, End);
+        return 0;
+    }
     InitVM();
 }
@@ -0,0 +1,1080 @@
+#include "Headers/error_log.h"
+#include "Headers/exec.h"
+#include "Headers/lexer.h"
+#include "Headers/parser.h"
+#include <unordered_set>
+
+// +++++++++++++++++
+// ++++ GLOBALS ++++
+// +++++++++++++++++
+
+// Variables of each block, like the code generation finds them: a name
+// refers to the last declaration before it in the block or in its parents
+ScopeTable<VarInfo*> Scopes;
+std::vector<std::unique_ptr<VarInfo>> Variables;
+
+// Functions called by the code left after the optimization, by the function
+// where the call is. The global code is the nullptr
+std::unordered_map<StrObj*, std::unordered_set<StrObj*>> Calls;
+StrObj* Caller = nullptr;
+
+// Computations moved out of loops, each one gets a hidden variable
+int Hoisted = 0;
+
+// Last definition of each function, like the code generation finds them
+std::unordered_map<StrObj*, FunctionAST*> Defined;
+
+VarInfo* Declare(BlockAST* Block, StrObj* Name) {
+    Variables.push_back(std::make_unique<VarInfo>());
+    Variables.back()->Owner = Caller;
+    Scopes.Set(Block, Name, Variables.back().get());
+    return Variables.back().get();
+}
+
+VarInfo* Lookup(BlockAST* Block, StrObj* Name) {
+    VarInfo** Info = Scopes.Get(Block, Name);
+    return Info ? *Info : nullptr;
+}
+
+// Replaces the node by its optimized version
+void Optimize(std::unique_ptr<DeclarationAST>& Node) {
+    if (!Node) {
+        return;
+    }
+    std::unique_ptr<DeclarationAST> New = Node->optimize();
+    if (New) {
+        Node = std::move(New);
+    }
+}
+
+void Resolve(std::unique_ptr<DeclarationAST>& Node) {
+    if (Node) {
+        Node->resolve();
+    }
+}
+
+// Reports the code left out of the program
+void Dead(const std::string& What) {
+    if (CobaluOpts.ShowDead) {
+        fprintf(stderr, "dead code: %s\n", What.c_str());
+    }
+}
+
+// Empty statement, what is left of a removed one
+std::unique_ptr<DeclarationAST> EmptyAST() {
+    return std::make_unique<InsideAST>(nullptr, nullptr);
+}
+
+// Nodes under the node, in the order they run
+std::vector<std::unique_ptr<DeclarationAST>*> Children(DeclarationAST* Node) {
+    std::vector<std::unique_ptr<DeclarationAST>*> Kids;
+    Node->children(Kids);
+    return Kids;
+}
+
+// Reports the names of removed code that the code generation wouldn't 
+// find. The code isn't generated, but a program has the same errors with
+// and without the optimizations
+void CheckNames(DeclarationAST* Node) {
+    if (!Node) {
+        return;
+    }
+
+    StrObj* Missing = nullptr;
+    if (auto Call = dynamic_cast<CallFuncAST*>(Node)) {
+        Missing = Call->Function() ? nullptr : Call->Name();
+    } else if (auto Val = dynamic_cast<VarValAST*>(Node)) {
+        Missing = Val->GetInfo() ? nullptr : Val->Name();
+    } else if (auto Decl = dynamic_cast<VarDeclAST*>(Node)) {
+        Missing = Decl->GetInfo() || Decl->Declares() ? nullptr : Decl->Name();
+    }
+    if (Missing) {
+        ErLogs.PushError(Missing->Text, "not identified", 2);
+    }
+
+    for (auto Kid : Children(Node)) {
+        CheckNames(Kid->get());
+    }
+}
+
+// Type of the result of a operation on the types of its operands. Only the
+// operations that can't fail have one, they are the same that can be folded
+int ResultType(int Op, int Left, int Right) {
+    if (Left == UNTYPED || Right == UNTYPED) {
+        return UNTYPED;
+    }
+    if (Left == UNRESOLVED || Right == UNRESOLVED) {
+        return UNRESOLVED;
+    }
+
+    switch (Op) {
+        case TOKEN_PLUS: {
+            return Left == Right && (Left == doub || Left == str) ? Left 
+                                                                  : UNTYPED;
+        }
+        case TOKEN_MINUS: case TOKEN_MUL: case TOKEN_DIV: {
+            return Left == doub && Right == doub ? doub : UNTYPED;
+        }
+        case TOKEN_EQUAL: case TOKEN_INEQUAL: {
+            return Left == Right && Left != nil ? boo : UNTYPED;
+        }
+        case TOKEN_GREATER: case TOKEN_LESS:
+        case TOKEN_GREATEQ: case TOKEN_LESSEQ: {
+            return Left == Right && Left != nil && Left != str ? boo 
+                                                               : UNTYPED;
+        }
+        case TOKEN_AND: case TOKEN_OR: {
+            // Only the strings fail as conditions
+            return Left != str && Right != str ? boo : UNTYPED;
+        }
+        default: {
+            return UNTYPED;
+        }
+    }
+}
+
+int UnaryType(int Op, int Operand) {
+    if (Operand == UNTYPED || Operand == UNRESOLVED) {
+        return Operand;
+    }
+    if (Op == TOKEN_MINUS && Operand == doub) {
+        return doub;
+    }
+    if (Op == TOKEN_NOT && (Operand == doub || Operand == boo)) {
+        return boo;
+    }
+    return UNTYPED;
+}
+
+// If the condition is a literal, tells if it always holds. The strings are
+// a error at runtime
+bool Constant(DeclarationAST* Cond, bool& Holds) {
+    Value Val;
+    if (!Cond || !Cond->Literal(Val) || Val.IsString()) {
+        return false;
+    }
+    Holds = !FalseValue(Val);
+    return true;
+}
+
+// Node of a literal value
+std::unique_ptr<DeclarationAST> LiteralAST(const Value& Val) {
+    switch (Val.Type()) {
+        case doub: {
+            return std::make_unique<DoubleAST>(Val.AsDouble());
+        }
+        case boo: {
+            return std::make_unique<BoolAST>(Val.AsBool());
+        }
+        case str: {
+            return std::make_unique<StringAST>(Intern(Val.AsString()->View()));
+        }
+        default: {
+            return std::make_unique<NullAST>();
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+////////////                       LITERALS                        ////////////
+///////////////////////////////////////////////////////////////////////////////
+
+bool DoubleAST::Literal(Value& Val) {
+    Val = DoubleValue;
+    return true;
+}
+
+bool StringAST::Literal(Value& Val) {
+    Val = StringValue;
+    return true;
+}
+
+bool BoolAST::Literal(Value& Val) {
+    Val = BoolValue;
+    return true;
+}
+
+bool NullAST::Literal(Value& Val) {
+    Val = nullptr;
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+////////////                      RESOLUTION                       ////////////
+///////////////////////////////////////////////////////////////////////////////
+
+// Follows the order of the code generation
+
+void OperationAST::resolve() {
+    Resolve(LHS);
+    Resolve(RHS);
+}
+
+void UnaryAST::resolve() {
+    Resolve(Expr);
+}
+
+void PrintAST::resolve() {
+    Resolve(Expr);
+}
+
+void VarDeclAST::resolve() {
+    // The value is resolved before the variable exists
+    Resolve(Expr);
+
+    if (Decl == 1) {
+        Info = Declare(ParentBlock, Variable);
+    } else {
+        Info = Lookup(ParentBlock, Variable);
+    }
+    if (Info) {
+        Info->Stores++;
+        Info->Escapes |= Info->Owner != Caller;
+        Info->Shared |= Info->Owner != Caller;
+    }
+}
+
+void VarValAST::resolve() {
+    Info = Lookup(ParentBlock, Variable);
+    if (Info) {
+        Info->Shared |= Info->Owner != Caller;
+    }
+}
+
+void InsideAST::resolve() {
+    Resolve(Exec);
+    Resolve(Chain);
+}
+
+void IfAST::resolve() {
+    Resolve(Cond);
+    Resolve(IfBlock);
+    Resolve(ElseBlock);
+}
+
+void WhileAST::resolve() {
+    Resolve(Cond);
+    Resolve(Loop);
+}
+
+void ForAST::resolve() {
+    Resolve(Var);
+    Resolve(Cond);
+    Resolve(Loop);
+    Resolve(Iterator);
+}
+
+void FunctionAST::resolve() {
+    Caller = Name;
+    Defined[Name] = this;
+
+    // The arguments change on every call
+    for (size_t i=0; i < Var.size(); i++) {
+        VarInfo* Info = Declare(Env, Var[i]);
+        Info->Stores = 2;
+        Info->Sources.push_back(nullptr);
+        Params.push_back(Info);
+    }
+    Resolve(Exec);
+
+    Caller = nullptr;
+}
+
+void CallFuncAST::resolve() {
+    for (size_t i=0; i < VarVal.size(); i++) {
+        Resolve(VarVal[i]);
+    }
+    auto Func = Defined.find(FuncName);
+    if (Func != Defined.end()) {
+        Callee = Func->second;
+    }
+}
+
+void ReturnAST::resolve() {
+    Resolve(RetVal);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+////////////                  CONSTANT FOLDING                     ////////////
+///////////////////////////////////////////////////////////////////////////////
+
+// Only operations that can't fail are folded, the errors stay at runtime. 
+// A logical operation whose left side decides is folded without looking at 
+// the right one, it never runs
+std::unique_ptr<DeclarationAST> OperationAST::optimize() {
+    Optimize(LHS);
+
+    bool Holds;
+    if (Logical(Op) && Constant(LHS.get(), Holds) && 
+        Holds == (Op == TOKEN_OR)) {
+        Dead("right side of a " + std::string(Holds ? "||" : "&&") + 
+             " that never runs");
+        CheckNames(RHS.get());
+        return std::make_unique<BoolAST>(Holds);
+    }
+    Optimize(RHS);
+
+    Value Left, Right;
+    if (!LHS->Literal(Left) || !RHS->Literal(Right)) {
+        return nullptr;
+    }
+
+    if (ResultType(Op, Left.Type(), Right.Type()) == UNTYPED) {
+        return nullptr;
+    }
+
+    Value Result;
+    switch (Op) {
+        case TOKEN_PLUS: AddValues(Left, Right, Result); break;
+        case TOKEN_MINUS: SubValues(Left, Right, Result); break;
+        case TOKEN_MUL: MulValues(Left, Right, Result); break;
+        case TOKEN_DIV: DivValues(Left, Right, Result); break;
+        case TOKEN_EQUAL: EqValues(Left, Right, Result); break;
+        case TOKEN_INEQUAL: IneqValues(Left, Right, Result); break;
+        case TOKEN_GREATER: GrValues(Left, Right, Result); break;
+        case TOKEN_LESS: LsValues(Left, Right, Result); break;
+        case TOKEN_GREATEQ: GreqValues(Left, Right, Result); break;
+        case TOKEN_LESSEQ: LseqValues(Left, Right, Result); break;
+        // The left side of the logical operations didn't decide
+        default: Result = !FalseValue(Right); break;
+    }
+    return LiteralAST(Result);
+}
+
+std::unique_ptr<DeclarationAST> UnaryAST::optimize() {
+    Optimize(Expr);
+
+    Value Operand;
+    if (!Expr->Literal(Operand)) {
+        return nullptr;
+    }
+
+    if (UnaryType(Op, Operand.Type()) == UNTYPED) {
+        return nullptr;
+    }
+
+    Value Result;
+    if (Op == TOKEN_MINUS) {
+        InvsigValue(Operand, Result);
+    } else {
+        NegValue(Operand, Result);
+    }
+    return LiteralAST(Result);
+}
+
+std::unique_ptr<DeclarationAST> PrintAST::optimize() {
+    Optimize(Expr);
+    return nullptr;
+}
+
+// A variable that is only stored by its declaration keeps the value of it
+std::unique_ptr<DeclarationAST> VarDeclAST::optimize() {
+    Optimize(Expr);
+
+    if (Decl == 1 && Info) {
+        Info->Known = Expr ? Expr->Literal(Info->Literal) : true;
+    }
+    return nullptr;
+}
+
+std::unique_ptr<DeclarationAST> VarValAST::optimize() {
+    if (Info && Info->Stores == 1 && Info->Known) {
+        return LiteralAST(Info->Literal);
+    }
+    return nullptr;
+}
+
+// The statements after one that never lets the execution pass are dropped
+std::unique_ptr<DeclarationAST> InsideAST::optimize() {
+    Optimize(Exec);
+    if (!Exec || !Exec->Terminates() || !Chain) {
+        Optimize(Chain);
+        return nullptr;
+    }
+
+    int Count = 0;
+    for (auto In = dynamic_cast<InsideAST*>(Chain.get()); In && In->Exec;
+         In = dynamic_cast<InsideAST*>(In->Chain.get())) {
+        Count++;
+    }
+    if (Count) {
+        Dead(std::to_string(Count) + (Count > 1 ? " statements" : " statement")
+             + " after a return or break");
+    }
+    CheckNames(Chain.get());
+    Chain = nullptr;
+    return nullptr;
+}
+
+// Only the branch that runs is left when the condition is a literal. The 
+// dead code is not optimized, so its calls don't keep functions alive
+std::unique_ptr<DeclarationAST> IfAST::optimize() {
+    Optimize(Cond);
+
+    bool Holds;
+    if (!Constant(Cond.get(), Holds)) {
+        Optimize(IfBlock);
+        Optimize(ElseBlock);
+        return nullptr;
+    }
+
+    if (Holds) {
+        if (ElseBlock) {
+            Dead("else of a if that always holds");
+            CheckNames(ElseBlock.get());
+        }
+        Optimize(IfBlock);
+        return std::move(IfBlock);
+    }
+    Dead("block of a if that never holds");
+    CheckNames(IfBlock.get());
+    if (!ElseBlock) {
+        return EmptyAST();
+    }
+    Optimize(ElseBlock);
+    return std::move(ElseBlock);
+}
+
+std::unique_ptr<DeclarationAST> WhileAST::optimize() {
+    Optimize(Cond);
+
+    bool Holds;
+    if (Constant(Cond.get(), Holds) && !Holds) {
+        Dead("while that never runs");
+        CheckNames(Loop.get());
+        return EmptyAST();
+    }
+    Optimize(Loop);
+    return nullptr;
+}
+
+// The variable of a for that never runs is still declared
+std::unique_ptr<DeclarationAST> ForAST::optimize() {
+    Optimize(Var);
+    Optimize(Cond);
+
+    bool Holds;
+    if (Constant(Cond.get(), Holds) && !Holds) {
+        Dead("for that never runs");
+        CheckNames(Loop.get());
+        CheckNames(Iterator.get());
+        return Var ? std::move(Var) : EmptyAST();
+    }
+    Optimize(Loop);
+    Optimize(Iterator);
+    return nullptr;
+}
+
+std::unique_ptr<DeclarationAST> FunctionAST::optimize() {
+    Caller = Name;
+    Optimize(Exec);
+    Caller = nullptr;
+    return nullptr;
+}
+
+// A inlined call doesn't keep its function alive
+std::unique_ptr<DeclarationAST> CallFuncAST::optimize() {
+    for (size_t i=0; i < VarVal.size(); i++) {
+        Optimize(VarVal[i]);
+    }
+
+    if (Callee) {
+        std::unique_ptr<DeclarationAST> Body = 
+            Callee->Inline(VarVal, ParentBlock);
+        if (Body) {
+            Optimize(Body);
+            return Body;
+        }
+    }
+    Calls[Caller].insert(FuncName);
+    return nullptr;
+}
+
+bool InsideAST::Terminates() {
+    return (Exec && Exec->Terminates()) || (Chain && Chain->Terminates());
+}
+
+bool IfAST::Terminates() {
+    return ElseBlock && IfBlock->Terminates() && ElseBlock->Terminates();
+}
+
+std::unique_ptr<DeclarationAST> ReturnAST::optimize() {
+    Optimize(RetVal);
+    return nullptr;
+}
+
+// The arguments and the variables with a known value were replaced by it, 
+// their declarations are dropped
+std::unique_ptr<DeclarationAST> InlineAST::optimize() {
+    for (auto& Stmt : Body) {
+        Optimize(Stmt);
+    }
+    Optimize(Result);
+
+    std::vector<std::unique_ptr<DeclarationAST>> Left;
+    for (auto& Stmt : Body) {
+        auto Decl = dynamic_cast<VarDeclAST*>(Stmt.get());
+        VarInfo* Info = Decl ? Decl->GetInfo() : nullptr;
+        if (Info && Info->Stores == 1 && Info->Known) {
+            continue;
+        }
+        Left.push_back(std::move(Stmt));
+    }
+    Body = std::move(Left);
+
+    if (Body.empty()) {
+        return std::move(Result);
+    }
+    return nullptr;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+////////////                       CHILDREN                        ////////////
+///////////////////////////////////////////////////////////////////////////////
+
+using Kids = std::vector<std::unique_ptr<DeclarationAST>*>;
+
+void OperationAST::children(Kids& Nodes) {
+    Nodes.insert(Nodes.end(), {&LHS, &RHS});
+}
+
+void UnaryAST::children(Kids& Nodes) {
+    Nodes.push_back(&Expr);
+}
+
+void PrintAST::children(Kids& Nodes) {
+    Nodes.push_back(&Expr);
+}
+
+void VarDeclAST::children(Kids& Nodes) {
+    Nodes.push_back(&Expr);
+}
+
+void InsideAST::children(Kids& Nodes) {
+    Nodes.insert(Nodes.end(), {&Exec, &Chain});
+}
+
+void IfAST::children(Kids& Nodes) {
+    Nodes.insert(Nodes.end(), {&Cond, &IfBlock, &ElseBlock});
+}
+
+void WhileAST::children(Kids& Nodes) {
+    Nodes.insert(Nodes.end(), {&Cond, &Loop});
+}
+
+void ForAST::children(Kids& Nodes) {
+    Nodes.insert(Nodes.end(), {&Var, &Cond, &Loop, &Iterator});
+}
+
+void FunctionAST::children(Kids& Nodes) {
+    Nodes.push_back(&Exec);
+}
+
+void CallFuncAST::children(Kids& Nodes) {
+    for (auto& Arg : VarVal) {
+        Nodes.push_back(&Arg);
+    }
+}
+
+void ReturnAST::children(Kids& Nodes) {
+    Nodes.push_back(&RetVal);
+}
+
+void InlineAST::children(Kids& Nodes) {
+    for (auto& Stmt : Body) {
+        Nodes.push_back(&Stmt);
+    }
+    Nodes.push_back(&Result);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+////////////                    TYPE INFERENCE                     ////////////
+///////////////////////////////////////////////////////////////////////////////
+
+int DeclarationAST::StaticType() {
+    Value Val;
+    return Literal(Val) ? Val.Type() : UNTYPED;
+}
+
+int OperationAST::StaticType() {
+    return ResultType(Op, LHS->StaticType(), RHS->StaticType());
+}
+
+int UnaryAST::StaticType() {
+    return UnaryType(Op, Expr->StaticType());
+}
+
+// Finds the values stored on each variable by the code that is left
+void Sources(DeclarationAST* Node) {
+    if (!Node) {
+        return;
+    }
+    auto Decl = dynamic_cast<VarDeclAST*>(Node);
+    if (Decl && Decl->GetInfo()) {
+        Decl->GetInfo()->Sources.push_back(Decl->Stored());
+    }
+    for (auto Kid : Children(Node)) {
+        Sources(Kid->get());
+    }
+}
+
+// A variable has a type if all the values stored on it have the same. They
+// start unresolved and lose the type when a store disagrees, until nothing
+// changes, so "i = i + 1" keeps the type of the declaration of i
+void InferTypes() {
+    for (auto& Info : Variables) {
+        Info->Type = Info->Sources.empty() ? UNTYPED : UNRESOLVED;
+    }
+
+    bool Changed = true;
+    while (Changed) {
+        Changed = false;
+        for (auto& Info : Variables) {
+            if (Info->Type == UNTYPED) {
+                continue;
+            }
+            int Type = UNRESOLVED;
+            for (DeclarationAST* Source : Info->Sources) {
+                int Stored = Source ? Source->StaticType() : UNTYPED;
+                if (Stored == UNRESOLVED) {
+                    continue;
+                }
+                Type = Type == UNRESOLVED || Type == Stored ? Stored : UNTYPED;
+            }
+            if (Type != Info->Type) {
+                Info->Type = Type;
+                Changed = true;
+            }
+        }
+    }
+
+    // Only variables stored with themselves are left, they are never set
+    for (auto& Info : Variables) {
+        if (Info->Type == UNRESOLVED) {
+            Info->Type = UNTYPED;
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+////////////              LOOP INVARIANT CODE MOTION               ////////////
+///////////////////////////////////////////////////////////////////////////////
+
+// Variables written by a loop and if it calls any function
+struct LoopWrites {
+    std::unordered_set<VarInfo*> Vars;
+    bool Calls = false;
+};
+
+void Writes(DeclarationAST* Node, LoopWrites& Loop) {
+    if (!Node) {
+        return;
+    }
+    if (auto Decl = dynamic_cast<VarDeclAST*>(Node)) {
+        Loop.Vars.insert(Decl->GetInfo());
+    }
+    if (dynamic_cast<CallFuncAST*>(Node)) {
+        Loop.Calls = true;
+    }
+    for (auto Kid : Children(Node)) {
+        Writes(Kid->get(), Loop);
+    }
+}
+
+// The variables read are not written by the loop, and can't be written by a
+// function called by it
+bool Invariant(DeclarationAST* Node, LoopWrites& Loop) {
+    if (auto Val = dynamic_cast<VarValAST*>(Node)) {
+        VarInfo* Info = Val->GetInfo();
+        return Info && !Loop.Vars.count(Info) && 
+               !(Loop.Calls && Info->Escapes);
+    }
+    for (auto Kid : Children(Node)) {
+        if (*Kid && !Invariant(Kid->get(), Loop)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Replaces the largest computations that don't change in the loop by a 
+// hidden variable stored in the preheader. Only computations of known type
+// are moved, they can't fail, so running them once before the loop, even if
+// it never runs, is the same as running them on every iteration
+void HoistFrom(std::unique_ptr<DeclarationAST>& Node, LoopWrites& Loop,
+               std::vector<std::unique_ptr<DeclarationAST>>& Preheader,
+               BlockAST* Block) {
+    if (!Node) {
+        return;
+    }
+
+    Kids Nodes = Children(Node.get());
+    bool Computation = dynamic_cast<OperationAST*>(Node.get()) ||
+                       dynamic_cast<UnaryAST*>(Node.get());
+    if (!Computation || Node->StaticType() == UNTYPED || 
+        !Invariant(Node.get(), Loop)) {
+        for (auto Kid : Nodes) {
+            HoistFrom(*Kid, Loop, Preheader, Block);
+        }
+        return;
+    }
+
+    StrObj* Name = Intern("%hoisted" + std::to_string(Hoisted++));
+    Variables.push_back(std::make_unique<VarInfo>());
+    VarInfo* Info = Variables.back().get();
+    Info->Stores = 1;
+    Info->Owner = Caller;
+    Info->Type = Node->StaticType();
+    Info->Sources.push_back(Node.get());
+
+    auto Decl = std::make_unique<VarDeclAST>(Name, 1, std::move(Node), Block);
+    Decl->SetInfo(Info);
+    Preheader.push_back(std::move(Decl));
+
+    auto Val = std::make_unique<VarValAST>(Name, Block);
+    Val->SetInfo(Info);
+    Node = std::move(Val);
+}
+
+void WhileAST::hoist() {
+    LoopWrites Writing;
+    Writes(Cond.get(), Writing);
+    Writes(Loop.get(), Writing);
+
+    HoistFrom(Cond, Writing, Preheader, ParentBlock);
+    HoistFrom(Loop, Writing, Preheader, ParentBlock);
+}
+
+// The variable of the for runs before the preheader
+void ForAST::hoist() {
+    LoopWrites Writing;
+    Writes(Cond.get(), Writing);
+    Writes(Loop.get(), Writing);
+    Writes(Iterator.get(), Writing);
+
+    HoistFrom(Cond, Writing, Preheader, ParentBlock);
+    HoistFrom(Loop, Writing, Preheader, ParentBlock);
+    HoistFrom(Iterator, Writing, Preheader, ParentBlock);
+}
+
+// The outer loops go first, so a computation leaves all the loops where it
+// doesn't change
+void Hoist(DeclarationAST* Node) {
+    if (!Node) {
+        return;
+    }
+    auto Func = dynamic_cast<FunctionAST*>(Node);
+    if (Func) {
+        Caller = Func->FuncName();
+    }
+    Node->hoist();
+    for (auto Kid : Children(Node)) {
+        Hoist(Kid->get());
+    }
+    if (Func) {
+        Caller = nullptr;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+////////////                       INLINING                        ////////////
+///////////////////////////////////////////////////////////////////////////////
+
+// The body of a small function that calls nothing is copied at its calls. Its
+// variables get hidden ones in the frame of the caller, and the arguments
+// are stored on them, or read in place when they are variables nothing else
+// writes
+
+// Variables of the function inlined and the ones that replace them at the
+// call, and the block of the call
+std::unordered_map<VarInfo*, std::pair<StrObj*, VarInfo*>> Renamed;
+BlockAST* InlineBlock;
+bool CloneFailed = false;
+int Inlined = 0;
+
+std::unique_ptr<DeclarationAST> Clone(const std::unique_ptr<DeclarationAST>& Node) {
+    if (!Node) {
+        return nullptr;
+    }
+    std::unique_ptr<DeclarationAST> Copy = Node->clone();
+    if (!Copy) {
+        CloneFailed = true;
+    }
+    return Copy;
+}
+
+int Size(DeclarationAST* Node) {
+    if (!Node) {
+        return 0;
+    }
+    int Nodes = 1;
+    for (auto Kid : Children(Node)) {
+        Nodes += Size(Kid->get());
+    }
+    return Nodes;
+}
+
+// Statements of a chain of blocks, in order
+void Statements(std::unique_ptr<DeclarationAST>& Node, Kids& Stmts) {
+    auto Inside = dynamic_cast<InsideAST*>(Node.get());
+    if (!Inside) {
+        if (Node) {
+            Stmts.push_back(&Node);
+        }
+        return;
+    }
+    for (auto Kid : Children(Inside)) {
+        Statements(*Kid, Stmts);
+    }
+}
+
+// Variable that a name of the function refers to at the call. A global must 
+// be the one that the name finds from the block of the call
+bool Rename(VarInfo* Info, StrObj*& Name, VarInfo*& To) {
+    auto Var = Renamed.find(Info);
+    if (Var != Renamed.end()) {
+        Name = Var->second.first;
+        To = Var->second.second;
+        return true;
+    }
+    To = Info;
+    return Info && !Info->Owner && Lookup(InlineBlock, Name) == Info;
+}
+
+// Hidden variable of the caller that replaces one of the function
+VarInfo* Hide(VarInfo* Info, StrObj*& Name) {
+    Name = Intern("%inline" + std::to_string(Inlined++));
+    Variables.push_back(std::make_unique<VarInfo>());
+    VarInfo* Hidden = Variables.back().get();
+    Hidden->Owner = Caller;
+    Renamed[Info] = {Name, Hidden};
+    return Hidden;
+}
+
+std::unique_ptr<DeclarationAST> DoubleAST::clone() {
+    return std::make_unique<DoubleAST>(DoubleValue);
+}
+
+std::unique_ptr<DeclarationAST> StringAST::clone() {
+    return std::make_unique<StringAST>(StringValue);
+}
+
+std::unique_ptr<DeclarationAST> BoolAST::clone() {
+    return std::make_unique<BoolAST>(BoolValue);
+}
+
+std::unique_ptr<DeclarationAST> NullAST::clone() {
+    return std::make_unique<NullAST>();
+}
+
+std::unique_ptr<DeclarationAST> OperationAST::clone() {
+    return std::make_unique<OperationAST>(Clone(LHS), Clone(RHS), Op);
+}
+
+std::unique_ptr<DeclarationAST> UnaryAST::clone() {
+    return std::make_unique<UnaryAST>(Clone(Expr), Op);
+}
+
+std::unique_ptr<DeclarationAST> PrintAST::clone() {
+    return std::make_unique<PrintAST>(Clone(Expr));
+}
+
+// Like the resolution, the value is cloned before the variable exists
+std::unique_ptr<DeclarationAST> VarDeclAST::clone() {
+    std::unique_ptr<DeclarationAST> Value = Clone(Expr);
+
+    StrObj* Name = Variable;
+    VarInfo* To;
+    if (Decl == 1) {
+        To = Hide(Info, Name);
+    } else if (!Rename(Info, Name, To)) {
+        return nullptr;
+    }
+    To->Stores++;
+
+    auto Copy = std::make_unique<VarDeclAST>(Name, Decl, std::move(Value), 
+                                             InlineBlock);
+    Copy->SetInfo(To);
+    return Copy;
+}
+
+std::unique_ptr<DeclarationAST> VarValAST::clone() {
+    StrObj* Name = Variable;
+    VarInfo* To;
+    if (!Rename(Info, Name, To)) {
+        return nullptr;
+    }
+    auto Copy = std::make_unique<VarValAST>(Name, InlineBlock);
+    Copy->SetInfo(To);
+    return Copy;
+}
+
+std::unique_ptr<DeclarationAST> InsideAST::clone() {
+    std::unique_ptr<DeclarationAST> First = Clone(Exec);
+    return std::make_unique<InsideAST>(Clone(Chain), std::move(First));
+}
+
+std::unique_ptr<DeclarationAST> IfAST::clone() {
+    std::unique_ptr<DeclarationAST> Condition = Clone(Cond);
+    std::unique_ptr<DeclarationAST> Then = Clone(IfBlock);
+    return std::make_unique<IfAST>(std::move(Condition), std::move(Then),
+                                   Clone(ElseBlock));
+}
+
+std::unique_ptr<DeclarationAST> WhileAST::clone() {
+    std::unique_ptr<DeclarationAST> Condition = Clone(Cond);
+    return std::make_unique<WhileAST>(std::move(Condition), Clone(Loop),
+                                      InlineBlock);
+}
+
+std::unique_ptr<DeclarationAST> ForAST::clone() {
+    std::unique_ptr<DeclarationAST> Variable = Clone(Var);
+    std::unique_ptr<DeclarationAST> Condition = Clone(Cond);
+    std::unique_ptr<DeclarationAST> Body = Clone(Loop);
+    return std::make_unique<ForAST>(std::move(Variable), std::move(Condition),
+                                    Clone(Iterator), std::move(Body), 
+                                    InlineBlock);
+}
+
+std::unique_ptr<DeclarationAST> BreakAST::clone() {
+    return std::make_unique<BreakAST>();
+}
+
+std::unique_ptr<DeclarationAST> InlineAST::clone() {
+    std::vector<std::unique_ptr<DeclarationAST>> Stmts;
+    for (auto& Stmt : Body) {
+        Stmts.push_back(Clone(Stmt));
+    }
+    return std::make_unique<InlineAST>(std::move(Stmts), Clone(Result));
+}
+
+// Only a return at the end is allowed, the value of the call is its value. 
+// The arguments are stored before the body, in order
+std::unique_ptr<DeclarationAST> 
+FunctionAST::Inline(std::vector<std::unique_ptr<DeclarationAST>>& Args,
+                    BlockAST* Block) {
+    if (!CobaluOpts.InlineSize || Args.size() != Params.size() ||
+        Size(Exec.get()) > CobaluOpts.InlineSize) {
+        return nullptr;
+    }
+    LoopWrites Writing;
+    Writes(Exec.get(), Writing);
+    if (Writing.Calls) {
+        return nullptr;
+    }
+
+    bool Effects = false;
+    for (auto& Arg : Args) {
+        Effects |= Arg->HasEffects();
+    }
+
+    Renamed.clear();
+    InlineBlock = Block;
+    CloneFailed = false;
+
+    std::vector<StrObj*> Names(Args.size(), nullptr);
+    for (size_t i=0; i < Args.size(); i++) {
+        auto Val = dynamic_cast<VarValAST*>(Args[i].get());
+        VarInfo* Info = Val ? Val->GetInfo() : nullptr;
+        if (Info && !Effects && !Writing.Vars.count(Info) && 
+            !Writing.Vars.count(Params[i])) {
+            Renamed[Params[i]] = {Val->Name(), Info};
+        } else {
+            Hide(Params[i], Names[i]);
+        }
+    }
+
+    Kids Stmts;
+    Statements(Exec, Stmts);
+    DeclarationAST* Returned = nullptr;
+    if (!Stmts.empty() && dynamic_cast<ReturnAST*>(Stmts.back()->get())) {
+        Returned = Stmts.back()->get();
+        Stmts.pop_back();
+    }
+
+    std::vector<std::unique_ptr<DeclarationAST>> Copies;
+    for (auto Stmt : Stmts) {
+        Copies.push_back(Clone(*Stmt));
+    }
+    std::unique_ptr<DeclarationAST> Result;
+    if (Returned) {
+        Result = Clone(*Children(Returned)[0]);
+    }
+    if (CloneFailed) {
+        return nullptr;
+    }
+    if (!Result) {
+        Result = std::make_unique<NullAST>();
+    }
+
+    // Nothing can fail from here, the arguments are taken
+    std::vector<std::unique_ptr<DeclarationAST>> Body;
+    for (size_t i=0; i < Args.size(); i++) {
+        if (Names[i]) {
+            VarInfo* Hidden = Renamed[Params[i]].second;
+            Hidden->Stores++;
+            auto Decl = std::make_unique<VarDeclAST>(Names[i], 1, 
+                                                     std::move(Args[i]), Block);
+            Decl->SetInfo(Hidden);
+            Body.push_back(std::move(Decl));
+        }
+    }
+    for (auto& Copy : Copies) {
+        Body.push_back(std::move(Copy));
+    }
+    return std::make_unique<InlineAST>(std::move(Body), std::move(Result));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+////////////                      FRONT PASS                       ////////////
+///////////////////////////////////////////////////////////////////////////////
+
+// The SSA form needs the variables found even if nothing is optimized
+void ResolveProgram(std::vector<std::unique_ptr<DeclarationAST>>& Program) {
+    for (auto& Decl : Program) {
+        Resolve(Decl);
+    }
+}
+
+// The stores of every variable must be known before any read is replaced,
+// so the program is resolved as a whole first
+void OptimizeProgram(std::vector<std::unique_ptr<DeclarationAST>>& Program) {
+    ResolveProgram(Program);
+    for (auto& Decl : Program) {
+        Optimize(Decl);
+    }
+
+    // Only the functions that the global code reaches are generated
+    std::unordered_set<StrObj*> Reached;
+    std::vector<StrObj*> Pending = {nullptr};
+    while (!Pending.empty()) {
+        StrObj* Func = Pending.back();
+        Pending.pop_back();
+        for (StrObj* Callee : Calls[Func]) {
+            if (Reached.insert(Callee).second) {
+                Pending.push_back(Callee);
+            }
+        }
+    }
+
+    std::vector<std::unique_ptr<DeclarationAST>> Live;
+    for (auto& Decl : Program) {
+        auto Func = dynamic_cast<FunctionAST*>(Decl.get());
+        if (Func && !Reached.count(Func->FuncName())) {
+            CheckNames(Func);
+            Dead("function " + std::string(Func->FuncName()->View()) + 
+                 " is never called");
+            continue;
+        }
+        Live.push_back(std::move(Decl));
+    }
+    Program = std::move(Live);
+
+    for (auto& Decl : Program) {
+        Sources(Decl.get());
+    }
+    InferTypes();
+    for (auto& Decl : Program) {
+        Hoist(Decl.get());
+    }
+}
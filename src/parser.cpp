@@ -10,6 +10,7 @@
 int CurToken;
 void getNextToken() {
     CurToken = Tokenizer();
+    ErLogs.SetPosition(TokenSpan.Line, TokenSpan.Column);
 }
 
 // Returns the precedence of operations.
@@ -18,8 +19,8 @@ int getPrecedence() {
     switch(CurToken) {
         default: return -1;
         case TOKEN_ATR: return 2;
-        case TOKEN_AND: return 3;
         case TOKEN_OR: return 3;
+        case TOKEN_AND: return 4;
         case TOKEN_EQUAL: return 5;
         case TOKEN_INEQUAL: return 5;
         case TOKEN_GREATER: return 5;
@@ -46,22 +47,24 @@ int isUnary() {
 
 // Forward definition
 std::unique_ptr<DeclarationAST> ExpressionParser \
-    (std::shared_ptr<BlockAST> CurBlock);
+    (BlockAST* CurBlock);
 std::unique_ptr<DeclarationAST> StatementParser \
-    (std::shared_ptr<BlockAST> CurBlock);
+    (BlockAST* CurBlock);
 std::unique_ptr<DeclarationAST> IdParser\
-(std::shared_ptr<BlockAST>);
+(BlockAST*);
 
 // number -> double
 std::unique_ptr<DeclarationAST> DoubleParser() {
+    double Number = TokenNumber();
     getNextToken(); // consume double
-    return std::make_unique<DoubleAST>(DoubleBuffer);
+    return std::make_unique<DoubleAST>(Number);
 }
 
 // string
 std::unique_ptr<DeclarationAST> StringParser() {
+    StrObj* String = Intern(TokenText());
     getNextToken(); // consume string
-    return std::make_unique<StringAST>(StringBuffer);
+    return std::make_unique<StringAST>(String);
 }
 
 // bool
@@ -81,7 +84,7 @@ std::unique_ptr<DeclarationAST> NullParser() {
 }
 
 // parenexpr -> '(' expression ')'
-std::unique_ptr<DeclarationAST> ParenParser(std::shared_ptr<BlockAST> CurBlock) 
+std::unique_ptr<DeclarationAST> ParenParser(BlockAST* CurBlock) 
 {
     getNextToken(); // consume '('
     
@@ -104,7 +107,7 @@ std::unique_ptr<DeclarationAST> ParenParser(std::shared_ptr<BlockAST> CurBlock)
 //         |  null
 //         |  parenexpr
 //         |  idstmt
-std::unique_ptr<DeclarationAST> PrimaryParser(std::shared_ptr<BlockAST> CurBlock) 
+std::unique_ptr<DeclarationAST> PrimaryParser(BlockAST* CurBlock) 
 {
     switch(CurToken) {
         default:{
@@ -134,7 +137,7 @@ std::unique_ptr<DeclarationAST> PrimaryParser(std::shared_ptr<BlockAST> CurBlock
 
 // unaryexpr -> '!'|'-' unary
 //           |  primary
-std::unique_ptr<DeclarationAST> UnaryParser(std::shared_ptr<BlockAST> CurBlock) 
+std::unique_ptr<DeclarationAST> UnaryParser(BlockAST* CurBlock) 
 {
     // If the current token is not a operator, it must be a primary
     if (!isUnary() || CurToken == '(' || CurToken == ',') {
@@ -156,7 +159,7 @@ std::unique_ptr<DeclarationAST> UnaryParser(std::shared_ptr<BlockAST> CurBlock)
 //           |  number '+' operation
 std::unique_ptr<DeclarationAST> OperationParser(int PrecLHS, 
                                         std::unique_ptr<DeclarationAST> LHS,
-                                        std::shared_ptr<BlockAST> CurBlock) 
+                                        BlockAST* CurBlock) 
 {
     // Mounts the operation precedence in reverse polish
     while (true) {
@@ -198,7 +201,7 @@ std::unique_ptr<DeclarationAST> OperationParser(int PrecLHS,
 
 // expression -> operation
 std::unique_ptr<DeclarationAST> \
-ExpressionParser(std::shared_ptr<BlockAST> CurBlock)
+ExpressionParser(BlockAST* CurBlock)
 {
     auto LHS = UnaryParser(CurBlock);
     if (!LHS) {
@@ -209,7 +212,7 @@ ExpressionParser(std::shared_ptr<BlockAST> CurBlock)
 }
 
 // printstmt -> print parenexpr
-std::unique_ptr<DeclarationAST> PrintParser(std::shared_ptr<BlockAST> CurBlock) 
+std::unique_ptr<DeclarationAST> PrintParser(BlockAST* CurBlock) 
 {
     getNextToken(); // consume print
     
@@ -228,13 +231,12 @@ std::unique_ptr<DeclarationAST> PrintParser(std::shared_ptr<BlockAST> CurBlock)
 
 // vardecl -> var id '(' = expression ')'?
 std::unique_ptr<DeclarationAST> \
-VarDeclParser(std::shared_ptr<BlockAST> CurBlock)
+VarDeclParser(BlockAST* CurBlock)
 {
     getNextToken(); // consume var
+    StrObj* VarName = TokenName();
     getNextToken(); // consume identifier
 
-    std::string VarName = Identifier;
-
     if (CurToken != TOKEN_ATR) {
         return std::make_unique<VarDeclAST>(VarName, 1, nullptr,
                                             CurBlock);
@@ -252,7 +254,7 @@ VarDeclParser(std::shared_ptr<BlockAST> CurBlock)
 
 // varassign -> id = expression
 std::unique_ptr<DeclarationAST>\
-VarAssignParser(std::shared_ptr<BlockAST> CurBlock, std::string IdName)
+VarAssignParser(BlockAST* CurBlock, StrObj* IdName)
 {
     getNextToken(); // consume '='
     auto Expr = ExpressionParser(CurBlock);
@@ -266,7 +268,7 @@ VarAssignParser(std::shared_ptr<BlockAST> CurBlock, std::string IdName)
 
 // callfunc -> id( expression? )
 std::unique_ptr<DeclarationAST>\
-CallFuncParser(std::shared_ptr<BlockAST> CurBlock, std::string IdName)
+CallFuncParser(BlockAST* CurBlock, StrObj* IdName)
 {
     getNextToken(); // consume '('
     std::unique_ptr<CallFuncAST> Caller =
@@ -293,10 +295,10 @@ CallFuncParser(std::shared_ptr<BlockAST> CurBlock, std::string IdName)
 //        -> variable
 //        -> callfunc
 std::unique_ptr<DeclarationAST>\
-IdParser(std::shared_ptr<BlockAST> CurBlock)
+IdParser(BlockAST* CurBlock)
 {
+    StrObj* IdName = TokenName();
     getNextToken(); // consume id
-    std::string IdName = Identifier;
 
     if (CurToken == TOKEN_ATR) {
         auto Var = VarAssignParser(CurBlock, IdName);
@@ -312,9 +314,10 @@ IdParser(std::shared_ptr<BlockAST> CurBlock)
 }
 
 // inside -> statement
-std::unique_ptr<DeclarationAST> InsideParser(std::shared_ptr<BlockAST> CurBlock) {
+std::unique_ptr<DeclarationAST> InsideParser(BlockAST* CurBlock) {
+    // The end of the block is a empty statement
     if (CurToken == '}') {
-        return std::make_unique<NullAST>();
+        return std::make_unique<InsideAST>(nullptr, nullptr);
     }
 
     auto Stmt = StatementParser(CurBlock);
@@ -330,12 +333,11 @@ std::unique_ptr<DeclarationAST> InsideParser(std::shared_ptr<BlockAST> CurBlock)
 }
 
 // block -> '{' inside '}'
-std::unique_ptr<DeclarationAST> BlockParser(std::shared_ptr<BlockAST> CurBlock)
+std::unique_ptr<DeclarationAST> BlockParser(BlockAST* CurBlock)
 {
     getNextToken(); // consume '{'
 
-    std::shared_ptr<BlockAST> CodeBlock =
-        std::make_shared<BlockAST>(CurBlock, COMMON);
+    BlockAST* CodeBlock = AstArena.New<BlockAST>(CurBlock, COMMON);
     if (CurBlock->ReturnState() != GLOBAL) {
         CodeBlock->ChangeState(CurBlock->ReturnState());
     }
@@ -351,7 +353,7 @@ std::unique_ptr<DeclarationAST> BlockParser(std::shared_ptr<BlockAST> CurBlock)
 }
 
 // ifstmt -> 'if' parenexpr statement '(' 'else' statement ')'?
-std::unique_ptr<DeclarationAST> IfParser(std::shared_ptr<BlockAST> CurBlock) {
+std::unique_ptr<DeclarationAST> IfParser(BlockAST* CurBlock) {
     getNextToken(); // consume if
 
     auto Cond = ParenParser(CurBlock);
@@ -383,7 +385,7 @@ std::unique_ptr<DeclarationAST> IfParser(std::shared_ptr<BlockAST> CurBlock) {
 
 // whilestmt -> 'while' parenexpr stmt
 std::unique_ptr<DeclarationAST> \
-WhileParser(std::shared_ptr<BlockAST> CurBlock)
+WhileParser(BlockAST* CurBlock)
 {
     getNextToken(); // consume while
 
@@ -395,7 +397,7 @@ WhileParser(std::shared_ptr<BlockAST> CurBlock)
 
     // Block need to be in state of Loop
     int CurState = CurBlock->ReturnState(); // Saves the current state
-    if (CurState == FUNC) {
+    if (CurState == FUNC || CurState == FUNCLOOP) {
         CurBlock->ChangeState(FUNCLOOP);
     } else {
         CurBlock->ChangeState(LOOP);
@@ -403,11 +405,12 @@ WhileParser(std::shared_ptr<BlockAST> CurBlock)
     auto Loop = StatementParser(CurBlock);
     CurBlock->ChangeState(CurState); // return to the previous state
 
-    return std::make_unique<WhileAST>(std::move(Cond), std::move(Loop));
+    return std::make_unique<WhileAST>(std::move(Cond), std::move(Loop),
+                                      CurBlock);
 }
 
 // forstmt -> 'for' '(' statement ';' expression ';' expression ')' statement
-std::unique_ptr<DeclarationAST> ForParser(std::shared_ptr<BlockAST> CurBlock)
+std::unique_ptr<DeclarationAST> ForParser(BlockAST* CurBlock)
 {
     getNextToken(); // consume 'for'
 
@@ -418,7 +421,7 @@ std::unique_ptr<DeclarationAST> ForParser(std::shared_ptr<BlockAST> CurBlock)
     getNextToken(); // consume '('
 
     int CurState = CurBlock->ReturnState(); // Saves the current state
-    if (CurState == FUNC) {
+    if (CurState == FUNC || CurState == FUNCLOOP) {
         CurBlock->ChangeState(FUNCLOOP);
     } else {
         CurBlock->ChangeState(LOOP);
@@ -454,12 +457,12 @@ std::unique_ptr<DeclarationAST> ForParser(std::shared_ptr<BlockAST> CurBlock)
 
     return std::make_unique<ForAST>(std::move(Var), std::move(Cond),
                                     std::move(Interator),
-                                    std::move(Loop));
+                                    std::move(Loop), CurBlock);
 }
 
 // breakstmt -> break
 std::unique_ptr<DeclarationAST>\
-BreakParser(std::shared_ptr<BlockAST> CurBlock)
+BreakParser(BlockAST* CurBlock)
 {
     getNextToken(); // consume break
     if (CurBlock->ReturnState() != LOOP && CurBlock->ReturnState() != FUNCLOOP) {
@@ -471,7 +474,7 @@ BreakParser(std::shared_ptr<BlockAST> CurBlock)
 
 // returstmt -> return expression?
 std::unique_ptr<DeclarationAST>\
-ReturnParser(std::shared_ptr<BlockAST> CurBlock) {
+ReturnParser(BlockAST* CurBlock) {
     getNextToken(); // consume return
     if (CurBlock->ReturnState() != FUNC && CurBlock->ReturnState() != FUNCLOOP) {
         ErLogs.PushError("return", "found in a block without func", 1);
@@ -490,7 +493,7 @@ ReturnParser(std::shared_ptr<BlockAST> CurBlock) {
 //           |  breakstmt
 //           |  returnstmt
 std::unique_ptr<DeclarationAST>\
-StatementParser(std::shared_ptr<BlockAST> CurBlock)
+StatementParser(BlockAST* CurBlock)
 {
     switch(CurToken) {
         case TOKEN_PRINT:
@@ -512,7 +515,8 @@ StatementParser(std::shared_ptr<BlockAST> CurBlock)
         case TOKEN_RET:
             return ReturnParser(CurBlock);
         default: {
-            ErLogs.PushError(Identifier, "statement not identified", 1); 
+            ErLogs.PushError(std::string(TokenText()),
+                             "statement not identified", 1);
             return nullptr;
         }
     }
@@ -520,7 +524,7 @@ StatementParser(std::shared_ptr<BlockAST> CurBlock)
 
 // function -> func id '(' id? ')' stmt
 std::unique_ptr<DeclarationAST>\
-FunctionParser(std::shared_ptr<BlockAST> CurBlock)
+FunctionParser(BlockAST* CurBlock)
 {
     getNextToken(); // consume func
     if (CurBlock->ReturnState() != GLOBAL) {
@@ -530,8 +534,8 @@ FunctionParser(std::shared_ptr<BlockAST> CurBlock)
     if (CurToken != TOKEN_ID) {
         ErLogs.PushError("", "identifier of function not found", 1);
     }
+    StrObj* IdName = TokenName();
     getNextToken(); // consume id
-    std::string IdName = Identifier;
 
     if (CurBlock->funcGetOffset(IdName) != -1) {
         ErLogs.PushError("", "function already defined", 1);
@@ -543,8 +547,9 @@ FunctionParser(std::shared_ptr<BlockAST> CurBlock)
     }
     getNextToken(); // consume '('
 
-    std::shared_ptr<BlockAST> FuncBlock =
-        std::make_shared<BlockAST>(CurBlock, FUNC);
+    // The block of the function owns the frame of its variables
+    BlockAST* FuncBlock = AstArena.New<BlockAST>(CurBlock, FUNC);
+    FuncBlock->OwnFrame();
 
     std::unique_ptr<FunctionAST> Func =
         std::make_unique<FunctionAST>(IdName, CurBlock);
@@ -556,8 +561,9 @@ FunctionParser(std::shared_ptr<BlockAST> CurBlock)
         } else if (CurToken == ',') {
             getNextToken(); // consume ','
         } else if (CurToken == TOKEN_ID) {
+            StrObj* Param = TokenName();
             getNextToken(); // consume id
-            if (!Func->SetVar(Identifier)) {
+            if (!Func->SetVar(Param)) {
                 ErLogs.PushError("", "variable already defined", 1);
             }
         } else {
@@ -580,7 +586,7 @@ FunctionParser(std::shared_ptr<BlockAST> CurBlock)
 //             |  expression
 //             |  function
 std::unique_ptr<DeclarationAST> \
-DeclarationParser(std::shared_ptr<BlockAST> CurBlock)
+DeclarationParser(BlockAST* CurBlock)
 {
     switch(CurToken) {
         case TOKEN_FUNC:
@@ -605,7 +611,7 @@ DeclarationParser(std::shared_ptr<BlockAST> CurBlock)
 }
 
 // program -> declaration
-std::unique_ptr<DeclarationAST> Parser(std::shared_ptr<BlockAST> Global) 
+std::unique_ptr<DeclarationAST> Parser(BlockAST* Global) 
 {
     if (CurToken == 0 || CurToken == ';'){
         getNextToken(); // Get the first token
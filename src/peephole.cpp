@@ -0,0 +1,95 @@
+#include "Headers/error_log.h"
+#include "Headers/vcm.h"
+
+// +++++++++++++++++
+// ++++ GLOBALS ++++
+// +++++++++++++++++
+
+// Times each rewrite was done and the instructions removed by all of them,
+// reported by the profiler
+std::map<std::string, int> Peepholes;
+int Eliminated = 0;
+
+///////////////////////////////////////////////////////////////////////////////
+////////////                    PEEPHOLE PASS                      ////////////
+///////////////////////////////////////////////////////////////////////////////
+
+// Instructions that keep the place where they go relative to themselves
+bool Jumps(Instruction inst) {
+    return inst == jmp || inst == jmpf || inst == jmpt || inst == funcsta;
+}
+
+// Rewrites the code generated before it runs:
+//  - the stop between the arguments of a call do nothing
+//  - a jump that lands on a jump goes straight to the end of the chain
+//  - a jump to the next instruction does nothing
+// The jumps keep where they land while the code is rewritten, and only get
+// their new offsets at the end
+void PeepholeOptimize() {
+    std::vector<Bytecode> Code(CobaluStack.Code(),
+                               CobaluStack.Code() + CobaluStack.Size());
+    int size = Code.size();
+
+    // Where each jump lands
+    std::vector<int> Target(size);
+    for (int i=0; i < size; i++) {
+        if (Jumps(Code[i].inst)) {
+            Target[i] = i + Code[i].offset + 1;
+        }
+    }
+
+    std::vector<bool> Removed(size + 1);
+    for (int i=0; i < size; i++) {
+        if (Code[i].inst == stop) {
+            Removed[i] = true;
+            Peepholes["stop"]++;
+        }
+    }
+
+    // A chain of jumps can't be longer than the code, unless it is a loop
+    for (int i=0; i < size; i++) {
+        if (!Jumps(Code[i].inst) || Code[i].inst == funcsta) {
+            continue;
+        }
+        for (int n=0; n < size && Target[i] < size &&
+             Code[Target[i]].inst == jmp && Target[Target[i]] != Target[i];
+             n++) {
+            Target[i] = Target[Target[i]];
+            Peepholes["jumps threaded"]++;
+        }
+    }
+
+    for (int i=0; i < size; i++) {
+        if (Code[i].inst != jmp) {
+            continue;
+        }
+        // Only removed instructions between the jump and where it lands
+        int next = i + 1;
+        while (next < Target[i] && Removed[next]) {
+            next++;
+        }
+        if (next == Target[i]) {
+            Removed[i] = true;
+            Peepholes["jump to next"]++;
+        }
+    }
+
+    // New place of each instruction, a removed one is replaced by the next
+    // that stays
+    std::vector<int> Moved(size + 1);
+    std::vector<Bytecode> Optimized;
+    for (int i=0; i <= size; i++) {
+        Moved[i] = Optimized.size();
+        if (i < size && !Removed[i]) {
+            Optimized.push_back(Code[i]);
+        }
+    }
+    for (int i=0; i < size; i++) {
+        if (!Removed[i] && Jumps(Code[i].inst)) {
+            Optimized[Moved[i]].offset = Moved[Target[i]] - Moved[i] - 1;
+        }
+    }
+
+    Eliminated += size - Optimized.size();
+    CobaluStack.Replace(std::move(Optimized), Moved);
+}
@@ -0,0 +1,418 @@
+#include "Headers/error_log.h"
+#include "Headers/exec.h"
+#include "Headers/vcm.h"
+#include "Headers/regvm.h"
+#include "Headers/dispatch.h"
+
+// +++++++++++++++++
+// ++++ GLOBALS ++++
+// +++++++++++++++++
+
+// Stack of instructions of the register machine
+RegisterStack RegStack;
+
+// Record of a function being executed
+struct RegFrame {
+    int Return; // instruction after the rcall
+    int Base; // first register of the caller
+    int Size; // registers of the function
+};
+
+// Registers of all the functions being executed. The frame of a callee
+// starts where the caller left the arguments
+std::vector<Value> Regs;
+std::vector<Value> RegGlobals;
+std::vector<RegFrame> RegFrames;
+
+///////////////////////////////////////////////////////////////////////////////
+////////////                  REGSTACK METHODS                     ////////////
+///////////////////////////////////////////////////////////////////////////////
+
+int RegisterStack::Push(RegBytecode byte) {
+    Stack.push_back(byte);
+    return Stack.size() - 1;
+}
+
+int RegisterStack::Size() {
+    return Stack.size();
+}
+
+RegBytecode& RegisterStack::At(int offset) {
+    return Stack[offset];
+}
+
+// Raw view of the stack, invalidated whenever the stack grows
+const RegBytecode* RegisterStack::Code() {
+    return Stack.data();
+}
+
+int RegOperands(RegInstruction inst) {
+    switch (inst) {
+        case radd: case rsub: case rmul: case rdiv:
+        case req: case rineq: case rgr: case rls: case rgreq: case rlseq: {
+            return 3;
+        }
+        case rneg: case rinv: case rmove:
+        case rjeq: case rjineq: case rjgr: case rjls: case rjgreq: case rjlseq:
+        case rjneq: case rjnineq: case rjngr: case rjnls: case rjngreq:
+        case rjnlseq: {
+            return 2;
+        }
+        case rprint: case rjmpf: case rjmpt: case rcall: case rret:
+        case rtail: {
+            return 1;
+        }
+        default: {
+            return 0;
+        }
+    }
+}
+
+// The temporaries of a function are placed after its variables, that are
+// only all known at the end of the body. They keep their kind, so a 
+// operation that fails knows if it was writing a temporary
+void RegisterStack::Relocate(int Start, int End, int Locals) {
+    for (; Start < End; Start++) {
+        RegBytecode& byte = Stack[Start];
+        uint16_t* Operands[] = {&byte.a, &byte.b, &byte.c};
+
+        for (int i=0; i < RegOperands(byte.inst); i++) {
+            uint16_t& Op = *Operands[i];
+            if ((Op & TEMP) != TEMP) {
+                continue;
+            }
+
+            int Index = Locals + (Op & OPERAND_INDEX);
+            if (Index > OPERAND_INDEX) {
+                LimitError("too many registers in a function, the limit is",
+                           OPERAND_INDEX + 1);
+            }
+            Op = TEMP | Index;
+        }
+    }
+}
+
+// Reserves a index on the table of functions
+int RegisterStack::AddFunc() {
+    Functions.push_back({0, 0, 1});
+    return Functions.size() - 1;
+}
+
+void RegisterStack::SetFunc(int index, int entry, int params, int size) {
+    Functions[index].Entry = entry;
+    Functions[index].Params = params;
+    Functions[index].Registers = size;
+}
+
+const RegFunction& RegisterStack::Func(int index) {
+    return Functions[index];
+}
+
+void RegisterStack::SetRegisters(int size) {
+    registers = size;
+}
+
+int RegisterStack::Registers() {
+    return registers;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+////////////                    VM EXECUTION                       ////////////
+///////////////////////////////////////////////////////////////////////////////
+
+// Where each kind of operand lives, indexed by its 2 high bits. Temporaries
+// are registers of the frame too
+#define OPERAND(x) Src[(x) >> 14][(x) & OPERAND_INDEX]
+#define TARGET(x) Dst[(x) >> 14][(x) & OPERAND_INDEX]
+#define FRAME() Src[0] = Src[3] = Dst[0] = Dst[3] = &Regs[Base]
+
+// The frames only grow the registers when they are opened, "--stack" limits
+// all the registers in use
+void GrowRegisters(size_t Size) {
+    if (Regs.size() >= Size) {
+        return;
+    }
+    if (Size > (size_t)CobaluOpts.StackLimit) {
+        LimitError("registers overflow, the limit is", CobaluOpts.StackLimit);
+    }
+    Regs.resize(Size);
+}
+
+// The stack machine pushes nothing when a operation fails, what uses the
+// value finds the stack empty
+void MissingValue() {
+    ErLogs.PushError("", "illegal instruction stack of execution is empty", 2);
+}
+
+// The stack machine finds the stack empty for each argument missing on a
+// call, when the function takes its parameters
+void MissingArgs(int Missing) {
+    for (int i=0; i < Missing; i++) {
+        MissingValue();
+    }
+}
+
+// A operation that failed leaves its temporary empty. A variable keeps the
+// value it had and the store fails, as it does on the stack machine
+#define NOVALUE(x) { \
+    if (((x) & TEMP) == TEMP) { \
+        TARGET(x) = Value::Empty(); \
+    } else { \
+        MissingValue(); \
+    } \
+    NEXT(); \
+}
+
+// a = b op c, the doubles are handled before calling the operation on values
+#define BINARY(inst, op, Operation) CASE(inst) { \
+    const Value& Left = OPERAND(code[sp].b); \
+    const Value& Right = OPERAND(code[sp].c); \
+    if (Left.IsDouble() && Right.IsDouble()) { \
+        TARGET(code[sp].a) = Left.AsDouble() op Right.AsDouble(); \
+        NEXT(); \
+    } \
+    if (Left.IsEmpty() || Right.IsEmpty()) { \
+        MissingValue(); \
+        NOVALUE(code[sp].a); \
+    } \
+    Value Result; \
+    if (!Operation(Left, Right, Result)) { \
+        NOVALUE(code[sp].a); \
+    } \
+    TARGET(code[sp].a) = std::move(Result); \
+    NEXT(); \
+}
+
+// Jump if (a op b) == When. A comparasion that fails leaves no condition, 
+// and without one the stack machine doesn't jump
+#define CMPJUMP(inst, op, Operation, When) CASE(inst) { \
+    const Value& Left = OPERAND(code[sp].a); \
+    const Value& Right = OPERAND(code[sp].b); \
+    if (Left.IsDouble() && Right.IsDouble()) { \
+        bool Cond = Left.AsDouble() op Right.AsDouble(); \
+        sp += Cond == When ? code[sp].Jump() : 1; \
+        DISPATCH(); \
+    } \
+    Value Result; \
+    if (Left.IsEmpty() || Right.IsEmpty()) { \
+        MissingValue(); \
+    } else if (Operation(Left, Right, Result)) { \
+        sp += Result.AsBool() == When ? code[sp].Jump() : 1; \
+        DISPATCH(); \
+    } \
+    MissingValue(); \
+    NEXT(); \
+}
+
+void RegExec() {
+    #ifdef THREADED_DISPATCH
+    // Must follow the order of the enum RegInstruction
+    static void* labels[] = {
+        &&L_radd, &&L_rsub, &&L_rmul, &&L_rdiv,
+        &&L_req, &&L_rineq, &&L_rgr, &&L_rls, &&L_rgreq, &&L_rlseq,
+        &&L_rneg, &&L_rinv, &&L_rmove,
+        &&L_rprint,
+        &&L_rjmp, &&L_rjmpf, &&L_rjmpt,
+        &&L_rjeq, &&L_rjineq, &&L_rjgr, &&L_rjls, &&L_rjgreq, &&L_rjlseq,
+        &&L_rjneq, &&L_rjnineq, &&L_rjngr, &&L_rjnls, &&L_rjngreq,
+        &&L_rjnlseq,
+        &&L_rcall, &&L_rret, &&L_rtail, &&L_rfuncend,
+        &&L_rend,
+    };
+    static_assert(sizeof(labels)/sizeof(labels[0]) == rend + 1,
+                  "labels out of sync with RegInstruction");
+    #endif
+
+    const RegBytecode* code = RegStack.Code();
+    int sp = 0;
+    int Base = 0;
+
+    RegGlobals.resize(CobaluStack.Globals());
+    GrowRegisters(RegStack.Registers());
+
+    const Value* Src[4] = {
+        Regs.data(), CobaluStack.Pool(), RegGlobals.data(), Regs.data()
+    };
+    Value* Dst[4] = {Regs.data(), nullptr, RegGlobals.data(), Regs.data()};
+
+    #ifdef THREADED_DISPATCH
+    DISPATCH();
+    #else
+    while (true) {
+    switch (code[sp].inst) {
+    #endif
+
+    BINARY(radd, +, AddValues)
+    BINARY(rsub, -, SubValues)
+    BINARY(rmul, *, MulValues)
+    BINARY(rdiv, /, DivValues)
+    BINARY(req, ==, EqValues)
+    BINARY(rineq, !=, IneqValues)
+    BINARY(rgr, >, GrValues)
+    BINARY(rls, <, LsValues)
+    BINARY(rgreq, >=, GreqValues)
+    BINARY(rlseq, <=, LseqValues)
+    CASE(rneg) {
+        const Value& Expr = OPERAND(code[sp].b);
+        Value Result;
+        if (Expr.IsEmpty()) {
+            MissingValue();
+            NOVALUE(code[sp].a);
+        }
+        if (!NegValue(Expr, Result)) {
+            NOVALUE(code[sp].a);
+        }
+        TARGET(code[sp].a) = std::move(Result);
+        NEXT();
+    }
+    CASE(rinv) {
+        const Value& Expr = OPERAND(code[sp].b);
+        if (Expr.IsDouble()) {
+            TARGET(code[sp].a) = -Expr.AsDouble();
+            NEXT();
+        }
+        Value Result;
+        if (Expr.IsEmpty()) {
+            MissingValue();
+            NOVALUE(code[sp].a);
+        }
+        if (!InvsigValue(Expr, Result)) {
+            NOVALUE(code[sp].a);
+        }
+        TARGET(code[sp].a) = std::move(Result);
+        NEXT();
+    }
+    CASE(rmove) {
+        const Value& Expr = OPERAND(code[sp].b);
+        if (Expr.IsEmpty()) {
+            NOVALUE(code[sp].a);
+        }
+        TARGET(code[sp].a) = Expr;
+        NEXT();
+    }
+    CASE(rprint) {
+        const Value& Expr = OPERAND(code[sp].a);
+        if (Expr.IsEmpty()) {
+            MissingValue();
+            NEXT();
+        }
+        PrintValue(Expr);
+        NEXT();
+    }
+    CASE(rjmp) {
+        sp += code[sp].Jump();
+        DISPATCH();
+    }
+    // Without a condition the stack machine doesn't jump
+    CASE(rjmpf) {
+        const Value& Cond = OPERAND(code[sp].a);
+        if (Cond.IsEmpty()) {
+            MissingValue();
+            NEXT();
+        }
+        int Fails = Cond.IsBool() ? !Cond.AsBool() : FalseValue(Cond);
+        sp += Fails ? code[sp].Jump() : 1;
+        DISPATCH();
+    }
+    CASE(rjmpt) {
+        const Value& Cond = OPERAND(code[sp].a);
+        if (Cond.IsEmpty()) {
+            MissingValue();
+            NEXT();
+        }
+        int Fails = Cond.IsBool() ? !Cond.AsBool() : FalseValue(Cond);
+        sp += !Fails ? code[sp].Jump() : 1;
+        DISPATCH();
+    }
+    CMPJUMP(rjeq, ==, EqValues, true)
+    CMPJUMP(rjineq, !=, IneqValues, true)
+    CMPJUMP(rjgr, >, GrValues, true)
+    CMPJUMP(rjls, <, LsValues, true)
+    CMPJUMP(rjgreq, >=, GreqValues, true)
+    CMPJUMP(rjlseq, <=, LseqValues, true)
+    CMPJUMP(rjneq, ==, EqValues, false)
+    CMPJUMP(rjnineq, !=, IneqValues, false)
+    CMPJUMP(rjngr, >, GrValues, false)
+    CMPJUMP(rjnls, <, LsValues, false)
+    CMPJUMP(rjngreq, >=, GreqValues, false)
+    CMPJUMP(rjnlseq, <=, LseqValues, false)
+    CASE(rcall) {
+        const RegFunction& Func = RegStack.Func(code[sp].b);
+        MissingArgs(code[sp].c);
+
+        if (RegFrames.size() >= (size_t)CobaluOpts.CallLimit) {
+            LimitError("too many nested calls, the limit is",
+                       CobaluOpts.CallLimit);
+        }
+        RegFrames.push_back({sp + 1, Base, Func.Registers});
+
+        // The arguments become the first registers of the callee
+        Base += code[sp].a & OPERAND_INDEX;
+        GrowRegisters(Base + Func.Registers);
+        FRAME();
+
+        sp = Func.Entry;
+        DISPATCH();
+    }
+    CASE(rret) {
+        Regs[Base] = OPERAND(code[sp].a);
+        goto ret;
+    }
+    CASE(rtail) {
+        const RegFunction& Func = RegStack.Func(code[sp].b);
+        RegFrame& Frame = RegFrames.back();
+        MissingArgs(code[sp].c);
+
+        // The arguments move to the first registers of the frame, that is
+        // released and then grown to the size of the callee
+        int Args = code[sp].a & OPERAND_INDEX;
+        for (int i=0; i < Func.Params; i++) {
+            Regs[Base + i] = Regs[Base + Args + i];
+        }
+        for (int i=Base+Func.Params; i < Base+Frame.Size; i++) {
+            Regs[i] = nullptr;
+        }
+        Frame.Size = Func.Registers;
+        GrowRegisters(Base + Func.Registers);
+        FRAME();
+
+        sp = Func.Entry;
+        DISPATCH();
+    }
+    CASE(rfuncend) {
+        // Function without return gives a null
+        Regs[Base] = nullptr;
+    ret:
+        // The value returned stays on the first register, the rest of the 
+        // frame is released
+        RegFrame Frame = RegFrames.back();
+        RegFrames.pop_back();
+        for (int i=Base+1; i < Base+Frame.Size; i++) {
+            Regs[i] = nullptr;
+        }
+
+        sp = Frame.Return;
+        Base = Frame.Base;
+        FRAME();
+        DISPATCH();
+    }
+    CASE(rend) {
+        goto exit;
+    }
+
+    #ifndef THREADED_DISPATCH
+    default: {
+        ErLogs.PushError("", "Instuction was not reconized", 2);
+        NEXT(); // the show must go on
+    }
+    }
+    }
+    #endif
+
+exit:
+    // If there is any error show all of them
+    if (ErLogs.NumErrors()) {
+       ErLogs.ShowErrors();
+       return;
+    }
+}
@@ -0,0 +1,407 @@
+#include "Headers/error_log.h"
+#include "Headers/exec.h"
+#include "Headers/lexer.h"
+#include "Headers/parser.h"
+#include "Headers/vcm.h"
+#include "Headers/ssa.h"
+
+// +++++++++++++++++
+// ++++ GLOBALS ++++
+// +++++++++++++++++
+
+std::vector<std::unique_ptr<IrFunction>> IrFunctions;
+
+// Function being built and the block where the code goes
+IrFunction* Ir = nullptr;
+int IrCurrent = 0;
+
+// Blocks after each loop being built, where its breaks go
+std::vector<int> IrBreaks;
+
+// Globals in memory and their slots
+std::unordered_map<VarInfo*, int> IrMemory;
+int IrShared = 0;
+
+///////////////////////////////////////////////////////////////////////////////
+////////////                   SSA CONSTRUCTION                    ////////////
+///////////////////////////////////////////////////////////////////////////////
+
+// The variables become values while the code is built, following Braun et
+// al. "Simple and Efficient Construction of Static Single Assignment Form".
+// A block is sealed once all its predecessors are known, a variable read in
+// a block that isn't sealed gets a phi that is completed when it is
+
+int NewBlock() {
+    Ir->Blocks.emplace_back();
+    return Ir->Blocks.size() - 1;
+}
+
+// The blocks are laid out in the order they are started
+void StartBlock(int Block) {
+    IrCurrent = Block;
+    Ir->Layout.push_back(Block);
+}
+
+void AddEdge(int From, int To) {
+    Ir->Blocks[From].Succs.push_back(To);
+    Ir->Blocks[To].Preds.push_back(From);
+}
+
+IrInst& NewValue(IrOp Op, std::vector<int> Args, int Imm) {
+    Ir->Values.emplace_back();
+    IrInst& Inst = Ir->Values.back();
+    Inst.Op = Op;
+    Inst.Imm = Imm;
+    Inst.Args = std::move(Args);
+    return Inst;
+}
+
+int IrEmit(IrOp Op, std::vector<int> Args, int Imm) {
+    NewValue(Op, std::move(Args), Imm).Block = IrCurrent;
+    int Val = Ir->Values.size() - 1;
+    Ir->Blocks[IrCurrent].Insts.push_back(Val);
+    return Val;
+}
+
+// The constants are in no block, they are generated where they are used
+int IrConst(Value Literal) {
+    NewValue(iconst, {}, 0).Literal = Literal;
+    return Ir->Values.size() - 1;
+}
+
+int NewPhi(int Block) {
+    NewValue(iphi, {}, 0).Block = Block;
+    int Phi = Ir->Values.size() - 1;
+    Ir->Blocks[Block].Phis.push_back(Phi);
+    return Phi;
+}
+
+void IrStart(IrFunction* Func) {
+    Ir = Func;
+    IrBreaks.clear();
+    int Entry = NewBlock();
+    Ir->Blocks[Entry].Sealed = true;
+    StartBlock(Entry);
+}
+
+void WriteVar(VarInfo* Var, int Block, int Val) {
+    Ir->Defs[Var][Block] = Val;
+}
+
+int ReadVar(VarInfo* Var, int Block);
+
+void AddPhiOperands(VarInfo* Var, int Phi) {
+    int Block = Ir->Values[Phi].Block;
+    for (int Pred : Ir->Blocks[Block].Preds) {
+        int Arg = ReadVar(Var, Pred);
+        Ir->Values[Phi].Args.push_back(Arg);
+    }
+}
+
+int ReadVar(VarInfo* Var, int Block) {
+    auto& Defs = Ir->Defs[Var];
+    auto Def = Defs.find(Block);
+    if (Def != Defs.end()) {
+        return Def->second;
+    }
+
+    int Val;
+    const std::vector<int>& Preds = Ir->Blocks[Block].Preds;
+    if (!Ir->Blocks[Block].Sealed) {
+        Val = NewPhi(Block);
+        Ir->Incomplete[Block].push_back({Var, Val});
+    } else if (Preds.size() == 1) {
+        Val = ReadVar(Var, Preds[0]);
+    } else if (Preds.empty()) {
+        // Only a block that is never reached has no value for it
+        Val = IrConst(nullptr);
+    } else {
+        // The phi is the value while its arguments are read, that ends the
+        // search around a loop
+        Val = NewPhi(Block);
+        WriteVar(Var, Block, Val);
+        AddPhiOperands(Var, Val);
+    }
+    WriteVar(Var, Block, Val);
+    return Val;
+}
+
+void Seal(int Block) {
+    for (auto& [Var, Phi] : Ir->Incomplete[Block]) {
+        AddPhiOperands(Var, Phi);
+    }
+    Ir->Incomplete.erase(Block);
+    Ir->Blocks[Block].Sealed = true;
+}
+
+void Jump(int To) {
+    AddEdge(IrCurrent, To);
+    IrEmit(ijmp);
+}
+
+void Branch(int Cond, int IfTrue, int IfFalse) {
+    AddEdge(IrCurrent, IfTrue);
+    AddEdge(IrCurrent, IfFalse);
+    IrEmit(ibranch, {Cond});
+}
+
+// The code after a break or a return goes to a block nothing reaches
+void Unreachable() {
+    int Block = NewBlock();
+    Seal(Block);
+    StartBlock(Block);
+}
+
+// Slot of a global kept in memory
+int MemorySlot(VarInfo* Var) {
+    auto Slot = IrMemory.find(Var);
+    if (Slot != IrMemory.end()) {
+        return Slot->second;
+    }
+    return IrMemory[Var] = IrShared++;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+////////////                     IR GENERATION                     ////////////
+///////////////////////////////////////////////////////////////////////////////
+
+// Statements don't have a value, they return -1
+
+int DoubleAST::irgen() {
+    return IrConst(DoubleValue);
+}
+
+int StringAST::irgen() {
+    return IrConst(StringValue);
+}
+
+int BoolAST::irgen() {
+    return IrConst(BoolValue);
+}
+
+int NullAST::irgen() {
+    return IrConst(nullptr);
+}
+
+// The value of a logical operation is merged from the blocks where the
+// condition holds and fails
+int OperationAST::irgen() {
+    if (!Logical(Op)) {
+        int Left = LHS->irgen();
+        int Right = RHS->irgen();
+        return IrEmit(ibinary, {Left, Right}, Op);
+    }
+
+    int True = NewBlock();
+    int False = NewBlock();
+    int Join = NewBlock();
+    irbranch(True, False);
+
+    Seal(True);
+    StartBlock(True);
+    Jump(Join);
+    Seal(False);
+    StartBlock(False);
+    Jump(Join);
+
+    Seal(Join);
+    StartBlock(Join);
+    int Phi = NewPhi(Join);
+    Ir->Values[Phi].Args = {IrConst(true), IrConst(false)};
+    return Phi;
+}
+
+void DeclarationAST::irbranch(int IfTrue, int IfFalse) {
+    Branch(irgen(), IfTrue, IfFalse);
+}
+
+// The right side runs in a block of its own, only reached when the left
+// side doesn't decide
+void OperationAST::irbranch(int IfTrue, int IfFalse) {
+    if (!Logical(Op)) {
+        DeclarationAST::irbranch(IfTrue, IfFalse);
+        return;
+    }
+
+    int Right = NewBlock();
+    if (Op == TOKEN_AND) {
+        LHS->irbranch(Right, IfFalse);
+    } else {
+        LHS->irbranch(IfTrue, Right);
+    }
+    Seal(Right);
+    StartBlock(Right);
+    RHS->irbranch(IfTrue, IfFalse);
+}
+
+int UnaryAST::irgen() {
+    return IrEmit(iunary, {Expr->irgen()}, Op);
+}
+
+int PrintAST::irgen() {
+    IrEmit(iprint, {Expr->irgen()});
+    return -1;
+}
+
+int VarValAST::irgen() {
+    if (!Info) {
+        ErLogs.PushError(Variable->Text, "not identified", 2);
+        return IrConst(nullptr);
+    }
+    if (Info->Shared) {
+        return IrEmit(iload, {}, MemorySlot(Info));
+    }
+    return ReadVar(Info, IrCurrent);
+}
+
+int VarDeclAST::irgen() {
+    int Val = Expr ? Expr->irgen() : IrConst(nullptr);
+
+    if (!Info) {
+        ErLogs.PushError(Variable->Text, "not identified", 2);
+    } else if (Info->Shared) {
+        IrEmit(istore, {Val}, MemorySlot(Info));
+    } else {
+        WriteVar(Info, IrCurrent, Val);
+    }
+    return -1;
+}
+
+int InsideAST::irgen() {
+    if (Exec) {
+        Exec->irgen();
+    }
+    if (Chain) {
+        Chain->irgen();
+    }
+    return -1;
+}
+
+int IfAST::irgen() {
+    int Then = NewBlock();
+    int Else = ElseBlock ? NewBlock() : -1;
+    int Join = NewBlock();
+    Cond->irbranch(Then, ElseBlock ? Else : Join);
+
+    Seal(Then);
+    StartBlock(Then);
+    IfBlock->irgen();
+    Jump(Join);
+
+    if (ElseBlock) {
+        Seal(Else);
+        StartBlock(Else);
+        ElseBlock->irgen();
+        Jump(Join);
+    }
+
+    Seal(Join);
+    StartBlock(Join);
+    return -1;
+}
+
+// Like the stack code, the body goes before the condition. The body is only
+// sealed when the condition is built, its variables get phis of one
+// argument meanwhile, that the passes remove
+void IrLoop(DeclarationAST* Cond, DeclarationAST* Loop,
+            DeclarationAST* Iterator) {
+    int Body = NewBlock();
+    int Head = NewBlock();
+    int Exit = NewBlock();
+    Jump(Head);
+
+    IrBreaks.push_back(Exit);
+    StartBlock(Body);
+    Loop->irgen();
+    if (Iterator) {
+        Iterator->irgen();
+    }
+    Jump(Head);
+
+    Seal(Head);
+    StartBlock(Head);
+    Cond->irbranch(Body, Exit);
+    Seal(Body);
+
+    IrBreaks.pop_back();
+    Seal(Exit);
+    StartBlock(Exit);
+}
+
+int WhileAST::irgen() {
+    for (auto& Decl : Preheader) {
+        Decl->irgen();
+    }
+    IrLoop(Cond.get(), Loop.get(), nullptr);
+    return -1;
+}
+
+int ForAST::irgen() {
+    Var->irgen();
+    for (auto& Decl : Preheader) {
+        Decl->irgen();
+    }
+    IrLoop(Cond.get(), Loop.get(), Iterator.get());
+    return -1;
+}
+
+int BreakAST::irgen() {
+    Jump(IrBreaks.back());
+    Unreachable();
+    return -1;
+}
+
+int FunctionAST::irgen() {
+    // Set the index of the function in both blocks
+    int Index = CobaluStack.AddFunc();
+    ParentBlock->funcSetOffset(Name, Index);
+    Env->funcSetOffset(Name, Index);
+
+    IrFunction* Outer = Ir;
+    int Block = IrCurrent;
+    std::vector<int> Breaks = std::move(IrBreaks);
+
+    IrFunctions.push_back(std::make_unique<IrFunction>());
+    IrFunction* Func = IrFunctions.back().get();
+    Func->Index = Index;
+    Func->Params = Var.size();
+    IrStart(Func);
+
+    for (int i=0; i < (int)Params.size(); i++) {
+        WriteVar(Params[i], IrCurrent, IrEmit(iparam, {}, i));
+    }
+    Exec->irgen();
+    IrEmit(iend);
+
+    Ir = Outer;
+    IrCurrent = Block;
+    IrBreaks = std::move(Breaks);
+    return -1;
+}
+
+int CallFuncAST::irgen() {
+    std::vector<int> Args;
+    for (int i=0; i < (int)VarVal.size(); i++) {
+        Args.push_back(VarVal[i]->irgen());
+    }
+
+    int Index = ParentBlock->funcGetOffset(FuncName);
+    if (Index == -1) {
+        ErLogs.PushError(FuncName->Text, "not identified", 2);
+        return IrConst(nullptr);
+    }
+    return IrEmit(icall, Args, Index);
+}
+
+int ReturnAST::irgen() {
+    IrEmit(iret, {RetVal ? RetVal->irgen() : IrConst(nullptr)});
+    Unreachable();
+    return -1;
+}
+
+int InlineAST::irgen() {
+    for (auto& Stmt : Body) {
+        Stmt->irgen();
+    }
+    return Result->irgen();
+}
@@ -0,0 +1,969 @@
+#include "Headers/error_log.h"
+#include "Headers/exec.h"
+#include "Headers/lexer.h"
+#include "Headers/parser.h"
+#include "Headers/vcm.h"
+#include "Headers/ssa.h"
+
+///////////////////////////////////////////////////////////////////////////////
+////////////                  CONTROL FLOW GRAPH                   ////////////
+///////////////////////////////////////////////////////////////////////////////
+
+bool Terminator(IrOp Op) {
+    return Op >= ijmp;
+}
+
+// Instructions whose value is kept until it is used
+bool Produces(IrOp Op) {
+    return Op == ibinary || Op == iunary || Op == iload || Op == icall;
+}
+
+// Blocks reached from the entry, each one before its successors except on
+// the edges back to a loop
+std::vector<int> ReversePostorder(IrFunction& Func) {
+    std::vector<int> Order;
+    std::vector<bool> Seen(Func.Blocks.size());
+    std::vector<std::pair<int, int>> Stack = {{0, 0}};
+    Seen[0] = true;
+    while (!Stack.empty()) {
+        auto& [Block, Next] = Stack.back();
+        if (Next < (int)Func.Blocks[Block].Succs.size()) {
+            int Succ = Func.Blocks[Block].Succs[Next++];
+            if (!Seen[Succ]) {
+                Seen[Succ] = true;
+                Stack.push_back({Succ, 0});
+            }
+            continue;
+        }
+        Order.push_back(Block);
+        Stack.pop_back();
+    }
+    std::reverse(Order.begin(), Order.end());
+    return Order;
+}
+
+// Immediate dominator of each reached block, following Cooper, Harvey and
+// Kennedy "A Simple, Fast Dominance Algorithm"
+std::vector<int> Dominators(IrFunction& Func) {
+    std::vector<int> Order = ReversePostorder(Func);
+    std::vector<int> Place(Func.Blocks.size());
+    for (int i=0; i < (int)Order.size(); i++) {
+        Place[Order[i]] = i;
+    }
+
+    std::vector<int> Idom(Func.Blocks.size(), -1);
+    Idom[0] = 0;
+    for (bool Changed = true; Changed; ) {
+        Changed = false;
+        for (int i=1; i < (int)Order.size(); i++) {
+            int New = -1;
+            for (int Pred : Func.Blocks[Order[i]].Preds) {
+                if (Idom[Pred] == -1) {
+                    continue;
+                }
+                if (New == -1) {
+                    New = Pred;
+                    continue;
+                }
+                int Other = Pred;
+                while (New != Other) {
+                    while (Place[New] > Place[Other]) {
+                        New = Idom[New];
+                    }
+                    while (Place[Other] > Place[New]) {
+                        Other = Idom[Other];
+                    }
+                }
+            }
+            if (Idom[Order[i]] != New) {
+                Idom[Order[i]] = New;
+                Changed = true;
+            }
+        }
+    }
+    return Idom;
+}
+
+// The blocks nothing reaches are dropped, with the arguments of the phis
+// that come from them
+void RemoveUnreachable(IrFunction& Func) {
+    std::vector<bool> Reached(Func.Blocks.size());
+    for (int Block : ReversePostorder(Func)) {
+        Reached[Block] = true;
+    }
+
+    for (int b=0; b < (int)Func.Blocks.size(); b++) {
+        IrBlock& Block = Func.Blocks[b];
+        Block.Reachable = Reached[b];
+        if (!Block.Reachable) {
+            for (int Phi : Block.Phis) {
+                Func.Values[Phi].Dead = true;
+            }
+            for (int Inst : Block.Insts) {
+                Func.Values[Inst].Dead = true;
+            }
+            continue;
+        }
+        for (int i=Block.Preds.size()-1; i >= 0; i--) {
+            if (Reached[Block.Preds[i]]) {
+                continue;
+            }
+            Block.Preds.erase(Block.Preds.begin() + i);
+            for (int Phi : Block.Phis) {
+                std::vector<int>& Args = Func.Values[Phi].Args;
+                Args.erase(Args.begin() + i);
+            }
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+////////////                        PASSES                         ////////////
+///////////////////////////////////////////////////////////////////////////////
+
+// A value replaced by another one points to it until the arguments are
+// rewritten
+int Find(std::vector<int>& Alias, int Val) {
+    while (Alias[Val] != Val) {
+        Val = Alias[Val] = Alias[Alias[Val]];
+    }
+    return Val;
+}
+
+std::vector<int> NoAlias(IrFunction& Func) {
+    std::vector<int> Alias(Func.Values.size());
+    for (int i=0; i < (int)Alias.size(); i++) {
+        Alias[i] = i;
+    }
+    return Alias;
+}
+
+void Rewrite(IrFunction& Func, std::vector<int>& Alias) {
+    for (IrInst& Inst : Func.Values) {
+        for (int& Arg : Inst.Args) {
+            Arg = Find(Alias, Arg);
+        }
+    }
+}
+
+// Copy propagation. A phi whose arguments are all the same value, or itself
+// around a loop, is a copy of that value
+void RemoveCopies(IrFunction& Func) {
+    std::vector<int> Alias = NoAlias(Func);
+    for (bool Changed = true; Changed; ) {
+        Changed = false;
+        for (IrBlock& Block : Func.Blocks) {
+            for (int Phi : Block.Phis) {
+                IrInst& Inst = Func.Values[Phi];
+                if (Inst.Dead) {
+                    continue;
+                }
+                int Same = -1;
+                bool Copy = true;
+                for (int Arg : Inst.Args) {
+                    Arg = Find(Alias, Arg);
+                    if (Arg == Phi || Arg == Same) {
+                        continue;
+                    }
+                    Copy = Same == -1;
+                    Same = Arg;
+                    if (!Copy) {
+                        break;
+                    }
+                }
+                if (Copy && Same != -1) {
+                    Alias[Phi] = Same;
+                    Inst.Dead = true;
+                    Changed = true;
+                }
+            }
+        }
+    }
+    Rewrite(Func, Alias);
+}
+
+// Type of each value, the same types the AST optimizer finds. The phis
+// start without one, so a loop gets the type its values keep around it
+void InferTypes(IrFunction& Func) {
+    for (IrInst& Inst : Func.Values) {
+        Inst.Type = Inst.Op == iconst ? Inst.Literal.Type() : UNRESOLVED;
+    }
+
+    std::vector<int> Order = ReversePostorder(Func);
+    for (bool Changed = true; Changed; ) {
+        Changed = false;
+        for (int b : Order) {
+            IrBlock& Block = Func.Blocks[b];
+            std::vector<int> Insts = Block.Phis;
+            Insts.insert(Insts.end(), Block.Insts.begin(), Block.Insts.end());
+            for (int Val : Insts) {
+                IrInst& Inst = Func.Values[Val];
+                if (Inst.Dead) {
+                    continue;
+                }
+
+                int Type = UNTYPED;
+                if (Inst.Op == ibinary) {
+                    Type = ResultType(Inst.Imm, Func.Values[Inst.Args[0]].Type,
+                                      Func.Values[Inst.Args[1]].Type);
+                } else if (Inst.Op == iunary) {
+                    Type = UnaryType(Inst.Imm, Func.Values[Inst.Args[0]].Type);
+                } else if (Inst.Op == iphi) {
+                    Type = UNRESOLVED;
+                    for (int Arg : Inst.Args) {
+                        int From = Func.Values[Arg].Type;
+                        if (From != UNRESOLVED) {
+                            Type = Type == UNRESOLVED || Type == From ? From
+                                                                      : UNTYPED;
+                        }
+                    }
+                }
+                if (Type != Inst.Type) {
+                    Inst.Type = Type;
+                    Changed = true;
+                }
+            }
+        }
+    }
+
+    for (IrInst& Inst : Func.Values) {
+        if (Inst.Type == UNRESOLVED) {
+            Inst.Type = UNTYPED;
+        }
+    }
+}
+
+// Common subexpression elimination. A operation that can't fail is
+// replaced by the same one in a block that dominates it. A global loaded
+// again, or after it was stored, keeps the value it had if no call or store
+// is between them in the block
+struct Numbering {
+    std::vector<std::vector<int>> Children;
+    std::map<std::vector<int>, int> Table;
+    std::vector<int> Alias;
+    int Epoch = 0;
+};
+
+void NumberBlock(IrFunction& Func, Numbering& Num, int Block) {
+    std::vector<std::vector<int>> Added;
+    int Memory = ++Num.Epoch;
+
+    for (int Val : Func.Blocks[Block].Insts) {
+        IrInst& Inst = Func.Values[Val];
+        if (Inst.Dead) {
+            continue;
+        }
+
+        std::vector<int> Key = {Inst.Op, Inst.Imm};
+        if (Inst.Op == istore || Inst.Op == icall) {
+            Memory = ++Num.Epoch;
+            if (Inst.Op == istore) {
+                Key = {iload, Inst.Imm, Memory};
+                Num.Table[Key] = Find(Num.Alias, Inst.Args[0]);
+                Added.push_back(Key);
+            }
+            continue;
+        } else if (Inst.Op == iload) {
+            Key.push_back(Memory);
+        } else if ((Inst.Op == ibinary || Inst.Op == iunary) &&
+                   Inst.Type != UNTYPED) {
+            for (int Arg : Inst.Args) {
+                Key.push_back(Find(Num.Alias, Arg));
+            }
+        } else {
+            continue;
+        }
+
+        auto Same = Num.Table.find(Key);
+        if (Same != Num.Table.end()) {
+            Num.Alias[Val] = Same->second;
+            Inst.Dead = true;
+        } else {
+            Num.Table[Key] = Val;
+            Added.push_back(Key);
+        }
+    }
+
+    for (int Child : Num.Children[Block]) {
+        NumberBlock(Func, Num, Child);
+    }
+    for (auto& Key : Added) {
+        Num.Table.erase(Key);
+    }
+}
+
+void NumberValues(IrFunction& Func) {
+    Numbering Num;
+    Num.Alias = NoAlias(Func);
+    Num.Children.resize(Func.Blocks.size());
+    std::vector<int> Idom = Dominators(Func);
+    for (int b=1; b < (int)Func.Blocks.size(); b++) {
+        if (Idom[b] != -1) {
+            Num.Children[Idom[b]].push_back(b);
+        }
+    }
+    NumberBlock(Func, Num, 0);
+    Rewrite(Func, Num.Alias);
+}
+
+// Dead code elimination. Only the values used by something that has an
+// effect are kept; a operation that may fail has the effect of its error
+void RemoveUnused(IrFunction& Func) {
+    std::vector<bool> Live(Func.Values.size());
+    std::vector<int> Pending;
+    for (int v=0; v < (int)Func.Values.size(); v++) {
+        IrInst& Inst = Func.Values[v];
+        bool Effect = Inst.Op == istore || Inst.Op == iprint ||
+                      Inst.Op == icall || Terminator(Inst.Op) ||
+                      ((Inst.Op == ibinary || Inst.Op == iunary) &&
+                       Inst.Type == UNTYPED);
+        if (!Inst.Dead && Effect) {
+            Live[v] = true;
+            Pending.push_back(v);
+        }
+    }
+
+    while (!Pending.empty()) {
+        int Val = Pending.back();
+        Pending.pop_back();
+        for (int Arg : Func.Values[Val].Args) {
+            if (!Live[Arg]) {
+                Live[Arg] = true;
+                Pending.push_back(Arg);
+            }
+        }
+    }
+
+    for (int v=0; v < (int)Func.Values.size(); v++) {
+        Func.Values[v].Dead |= !Live[v];
+    }
+}
+
+void SsaOptimize(IrFunction& Func) {
+    RemoveUnreachable(Func);
+    RemoveCopies(Func);
+    InferTypes(Func);
+    NumberValues(Func);
+    RemoveCopies(Func);
+    RemoveUnused(Func);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+////////////                       LOWERING                        ////////////
+///////////////////////////////////////////////////////////////////////////////
+
+// The values go back to the stack. A value used once, by the instruction
+// right after it, is left on the stack for it, so a expression is generated
+// like a tree again. The rest of the values are stored on slots of the
+// frame, the globals on the global code. A phi gets its value by the
+// predecessors, that store it before jumping to the block
+
+// Function being lowered
+IrFunction* Low = nullptr;
+std::vector<int> Uses;
+std::vector<int> Slot;
+std::vector<bool> Tree; // computed where it is used
+
+void EmitInst(Instruction Inst, int Offset = 0) {
+    Bytecode byte;
+    byte.inst = Inst;
+    byte.offset = Offset;
+    CobaluStack.Push(byte);
+}
+
+void StoreSlot(int Val) {
+    EmitInst(Low->Index == -1 ? glbst : varst, Slot[Val]);
+}
+
+void Compute(int Val);
+
+void PushValue(int Val) {
+    IrInst& Inst = Low->Values[Val];
+    if (Inst.Op != iconst) {
+        if (Tree[Val]) {
+            Compute(Val);
+        } else {
+            EmitInst(Low->Index == -1 ? glbrt : varrt, Slot[Val]);
+        }
+        return;
+    }
+
+    switch (Inst.Literal.Type()) {
+        case doub: {
+            EmitInst(ndoubl, CobaluStack.AddConst(Inst.Literal));
+            break;
+        }
+        case str: {
+            EmitInst(cstr, CobaluStack.AddConst(Inst.Literal.AsString()));
+            break;
+        }
+        case boo: {
+            EmitInst(bolen, Inst.Literal.AsBool());
+            break;
+        }
+        default: {
+            EmitInst(none);
+        }
+    }
+}
+
+void Compute(int Val) {
+    IrInst& Inst = Low->Values[Val];
+    for (int Arg : Inst.Args) {
+        PushValue(Arg);
+    }
+
+    switch (Inst.Op) {
+        case ibinary: {
+            EmitInst(Typed(getInstruction(Inst.Imm), 
+                           Low->Values[Inst.Args[0]].Type,
+                           Low->Values[Inst.Args[1]].Type));
+            break;
+        }
+        case iunary: {
+            EmitInst(Inst.Imm == TOKEN_MINUS ? invsig : negte);
+            break;
+        }
+        case iload: {
+            EmitInst(glbrt, Inst.Imm);
+            break;
+        }
+        case istore: {
+            EmitInst(glbst, Inst.Imm);
+            break;
+        }
+        case iprint: {
+            EmitInst(stio);
+            break;
+        }
+        case icall: {
+            EmitInst(callfunc, Inst.Imm);
+            break;
+        }
+        default: {
+            break;
+        }
+    }
+}
+
+// Phis of the successor and the values the block gives them
+std::vector<std::pair<int, int>> EdgeCopies(int Block, int Succ) {
+    std::vector<std::pair<int, int>> Pairs;
+    IrBlock& To = Low->Blocks[Succ];
+    int Pred = std::find(To.Preds.begin(), To.Preds.end(), Block) -
+               To.Preds.begin();
+    for (int Phi : To.Phis) {
+        int Arg = Low->Values[Phi].Args[Pred];
+        if (!Low->Values[Phi].Dead && Arg != Phi) {
+            Pairs.push_back({Phi, Arg});
+        }
+    }
+    return Pairs;
+}
+
+// The copies of all the successors are given at once, so they go in the
+// order the block computes the values, the ones from other blocks first
+std::vector<std::pair<int, int>> Copies(int Block) {
+    std::vector<std::pair<int, int>> Pairs;
+    for (int Succ : Low->Blocks[Block].Succs) {
+        for (auto& Pair : EdgeCopies(Block, Succ)) {
+            Pairs.push_back(Pair);
+        }
+    }
+
+    // The values of a block are numbered in order
+    auto Place = [&](const std::pair<int, int>& Pair) {
+        const IrInst& Inst = Low->Values[Pair.second];
+        return Inst.Block == Block && Inst.Op != iphi ? Pair.second : -1;
+    };
+    std::stable_sort(Pairs.begin(), Pairs.end(), 
+                     [&](auto& A, auto& B) { return Place(A) < Place(B); });
+    return Pairs;
+}
+
+// If the value reads the slot
+bool ReadsSlot(int Val, int Target) {
+    if (Low->Values[Val].Op == iconst) {
+        return false;
+    }
+    if (!Tree[Val]) {
+        return Slot[Val] == Target;
+    }
+    for (int Arg : Low->Values[Val].Args) {
+        if (ReadsSlot(Arg, Target)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// The copies are done in order. A phi whose slot is read by a later copy
+// keeps its value on the stack, and is stored after all of them. A phi that
+// shares the slot of its value needs no copy
+void EmitCopies(const std::vector<std::pair<int, int>>& Pairs) {
+    std::vector<int> Kept;
+    for (int i=0; i < (int)Pairs.size(); i++) {
+        auto [Phi, Arg] = Pairs[i];
+        if (!Tree[Arg] && Slot[Arg] == Slot[Phi]) {
+            continue;
+        }
+        PushValue(Arg);
+
+        bool Read = false;
+        for (int j=i+1; j < (int)Pairs.size(); j++) {
+            Read |= ReadsSlot(Pairs[j].second, Slot[Phi]);
+        }
+        if (Read) {
+            Kept.push_back(Phi);
+        } else {
+            StoreSlot(Phi);
+        }
+    }
+    for (int i=Kept.size()-1; i >= 0; i--) {
+        StoreSlot(Kept[i]);
+    }
+}
+
+// Values used by the instruction, in the order they are pushed
+std::vector<int> Operands(int Block, int Val) {
+    IrInst& Inst = Low->Values[Val];
+    if (Inst.Op == ijmp) {
+        std::vector<int> Args;
+        for (auto& [Phi, Arg] : Copies(Block)) {
+            Args.push_back(Arg);
+        }
+        return Args;
+    }
+    return Inst.Args;
+}
+
+// Takes the operands that are computed right before the instruction into
+// its tree. It stops at the first one that has to stay where it is
+void Absorb(int Block, const std::vector<int>& Code, int Val, int& Before) {
+    std::vector<int> Args = Operands(Block, Val);
+    for (int i=Args.size()-1; i >= 0 && Before >= 0; i--) {
+        int Arg = Args[i];
+        if (Arg != Code[Before]) {
+            continue;
+        }
+        if (Uses[Arg] != 1) {
+            return;
+        }
+        Tree[Arg] = true;
+        Before--;
+        Absorb(Block, Code, Arg, Before);
+    }
+}
+
+// Values the instruction reads from their slots
+void Reads(int Val, std::vector<int>& Read) {
+    if (Low->Values[Val].Op == iconst) {
+        return;
+    }
+    if (!Tree[Val]) {
+        Read.push_back(Val);
+        return;
+    }
+    for (int Arg : Low->Values[Val].Args) {
+        Reads(Arg, Read);
+    }
+}
+
+std::vector<int> ReadsOf(int Block, int Val) {
+    std::vector<int> Args = Operands(Block, Val);
+    if (Low->Values[Val].Op == ibranch) {
+        for (auto& [Phi, Arg] : Copies(Block)) {
+            Args.push_back(Arg);
+        }
+    }
+
+    std::vector<int> Read;
+    for (int Arg : Args) {
+        Reads(Arg, Read);
+    }
+    return Read;
+}
+
+// Values whose slot is read after the start and the end of each block, the
+// ones given to a phi are read at the end of the predecessor
+std::vector<std::vector<int>> Code; // instructions of each block
+std::vector<int> Place; // of each value in its block, -1 for phis
+std::vector<std::vector<bool>> LiveIn;
+std::vector<std::vector<bool>> LiveOut;
+
+void Liveness(const std::vector<int>& Layout) {
+    int Blocks = Low->Blocks.size();
+    int Values = Low->Values.size();
+    LiveIn.assign(Blocks, std::vector<bool>(Values));
+    LiveOut.assign(Blocks, std::vector<bool>(Values));
+
+    // Read in the block before they are defined in it
+    std::vector<std::vector<bool>> Up(Blocks, std::vector<bool>(Values));
+    std::vector<std::vector<int>> Given(Blocks);
+    for (int Block : Layout) {
+        for (int Val : Code[Block]) {
+            if (Tree[Val]) {
+                continue;
+            }
+            for (int Read : ReadsOf(Block, Val)) {
+                Up[Block][Read] = Low->Values[Read].Block != Block;
+            }
+        }
+        for (auto& [Phi, Arg] : Copies(Block)) {
+            Reads(Arg, Given[Block]);
+        }
+    }
+
+    for (bool Changed = true; Changed; ) {
+        Changed = false;
+        for (int l=Layout.size()-1; l >= 0; l--) {
+            int Block = Layout[l];
+            std::vector<bool> Out(Values);
+            for (int Succ : Low->Blocks[Block].Succs) {
+                for (int v=0; v < Values; v++) {
+                    Out[v] = Out[v] || LiveIn[Succ][v];
+                }
+            }
+            for (int Val : Given[Block]) {
+                Out[Val] = true;
+            }
+
+            std::vector<bool> In = Up[Block];
+            for (int v=0; v < Values; v++) {
+                In[v] = In[v] || (Out[v] && Low->Values[v].Block != Block);
+            }
+            if (In != LiveIn[Block] || Out != LiveOut[Block]) {
+                LiveIn[Block] = std::move(In);
+                LiveOut[Block] = std::move(Out);
+                Changed = true;
+            }
+        }
+    }
+}
+
+// If the slot of the value is read after the place in the block
+bool LiveAfter(int Val, int Block, int After) {
+    if (Low->Values[Val].Block == Block ? Place[Val] > After 
+                                        : !LiveIn[Block][Val]) {
+        return false;
+    }
+    if (LiveOut[Block][Val]) {
+        return true;
+    }
+    for (int i=After+1; i < (int)Code[Block].size(); i++) {
+        if (Tree[Code[Block][i]]) {
+            continue;
+        }
+        std::vector<int> Read = ReadsOf(Block, Code[Block][i]);
+        if (std::find(Read.begin(), Read.end(), Val) != Read.end()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Two values can share a slot if none is read after the other is defined
+bool Interfere(int A, int B) {
+    return LiveAfter(A, Low->Values[B].Block, Place[B]) ||
+           LiveAfter(B, Low->Values[A].Block, Place[A]);
+}
+
+// Each phi tries to share the slot of its values, so the copies go away.
+// The values that share a slot are a class, the arguments of the function
+// keep theirs
+int AssignSlots(const std::vector<int>& Layout, int Base) {
+    int Values = Low->Values.size();
+    std::vector<int> Class(Values);
+    std::vector<std::vector<int>> Members(Values);
+    for (int v=0; v < Values; v++) {
+        Class[v] = v;
+        Members[v] = {v};
+    }
+
+    for (int Block : Layout) {
+        for (int Phi : Low->Blocks[Block].Phis) {
+            if (Low->Values[Phi].Dead) {
+                continue;
+            }
+            for (int Arg : Low->Values[Phi].Args) {
+                int From = Class[Phi], To = Class[Arg];
+                if (Low->Values[Arg].Op == iconst || Tree[Arg] || From == To) {
+                    continue;
+                }
+
+                bool Free = true;
+                int Params = 0;
+                for (int A : Members[From]) {
+                    for (int B : Members[To]) {
+                        Free = Free && !Interfere(A, B);
+                    }
+                }
+                for (int A : Members[From]) {
+                    Params += Low->Values[A].Op == iparam;
+                }
+                for (int B : Members[To]) {
+                    Params += Low->Values[B].Op == iparam;
+                }
+                if (!Free || Params > 1) {
+                    continue;
+                }
+
+                for (int B : Members[To]) {
+                    Class[B] = From;
+                    Members[From].push_back(B);
+                }
+                Members[To].clear();
+            }
+        }
+    }
+
+    Slot.assign(Values, -1);
+    std::vector<int> Slots(Values, -1);
+    for (int v=0; v < Values; v++) {
+        if (Low->Values[v].Op == iparam) {
+            Slots[Class[v]] = Low->Values[v].Imm;
+        }
+    }
+    for (int v=0; v < Values; v++) {
+        IrInst& Inst = Low->Values[v];
+        if (Inst.Dead || Inst.Op == iconst || Tree[v] || 
+            (!Uses[v] && Inst.Op != iparam)) {
+            continue;
+        }
+        if (Slots[Class[v]] == -1) {
+            Slots[Class[v]] = Base++;
+        }
+        Slot[v] = Slots[Class[v]];
+    }
+    return Base;
+}
+
+// A block that goes two ways gives the values of the phis before the
+// branch. If the other way reads the slots they are stored on, or gives
+// values too, the copies go on blocks of their own
+void SplitEdges(std::vector<int>& Layout) {
+    int Blocks = Layout.size();
+    // The jumps of the new blocks have no slot and are not live anywhere
+    int Values = Slot.size();
+    for (int l=0; l < Blocks; l++) {
+        int Block = Layout[l];
+        std::vector<int> Succs = Low->Blocks[Block].Succs;
+        if (Succs.size() < 2) {
+            continue;
+        }
+
+        // Slots stored on each way
+        std::vector<int> Stored[2];
+        for (int s=0; s < 2; s++) {
+            for (auto [Phi, Arg] : EdgeCopies(Block, Succs[s])) {
+                if (Tree[Arg] || Slot[Arg] != Slot[Phi]) {
+                    Stored[s].push_back(Slot[Phi]);
+                }
+            }
+        }
+
+        bool Split = !Stored[0].empty() && !Stored[1].empty();
+        for (int s=0; s < 2; s++) {
+            for (int v=0; v < Values; v++) {
+                Split |= LiveIn[Succs[1 - s]][v] &&
+                         std::find(Stored[s].begin(), Stored[s].end(), 
+                                   Slot[v]) != Stored[s].end();
+            }
+        }
+        if (!Split) {
+            continue;
+        }
+
+        for (int s=0; s < 2; s++) {
+            if (Stored[s].empty()) {
+                continue;
+            }
+            int Succ = Succs[s];
+            int Edge = Low->Blocks.size();
+            Low->Blocks.emplace_back();
+            Low->Blocks[Edge].Preds = {Block};
+            Low->Blocks[Edge].Succs = {Succ};
+            Low->Blocks[Block].Succs[s] = Edge;
+            std::vector<int>& Preds = Low->Blocks[Succ].Preds;
+            *std::find(Preds.begin(), Preds.end(), Block) = Edge;
+
+            Low->Values.emplace_back();
+            Low->Values.back().Op = ijmp;
+            Low->Values.back().Block = Edge;
+            Low->Blocks[Edge].Insts = {(int)Low->Values.size() - 1};
+            Code.push_back(Low->Blocks[Edge].Insts);
+            Tree.push_back(false);
+            Layout.push_back(Edge);
+        }
+    }
+}
+
+int SsaLower(IrFunction& Func, int Base) {
+    Low = &Func;
+
+    std::vector<int> Layout;
+    for (int Block : Func.Layout) {
+        if (Func.Blocks[Block].Reachable) {
+            Layout.push_back(Block);
+        }
+    }
+
+    // The code of each block, without the phis and the arguments, that
+    // aren't instructions
+    Code.assign(Func.Blocks.size(), {});
+    Place.assign(Func.Values.size(), -1);
+    Uses.assign(Func.Values.size(), 0);
+    for (int Block : Layout) {
+        for (int Val : Func.Blocks[Block].Insts) {
+            IrInst& Inst = Func.Values[Val];
+            if (Inst.Dead) {
+                continue;
+            }
+            for (int Arg : Inst.Args) {
+                Uses[Arg]++;
+            }
+            if (Inst.Op != iparam) {
+                Place[Val] = Code[Block].size();
+                Code[Block].push_back(Val);
+            }
+        }
+        for (auto& [Phi, Arg] : Copies(Block)) {
+            Uses[Arg]++;
+        }
+    }
+
+    Tree.assign(Func.Values.size(), false);
+    for (int Block : Layout) {
+        std::vector<int>& Insts = Code[Block];
+        for (int i=Insts.size()-1; i >= 0; i--) {
+            if (!Tree[Insts[i]]) {
+                int Before = i - 1;
+                Absorb(Block, Insts, Insts[i], Before);
+            }
+        }
+    }
+
+    Liveness(Layout);
+    int Slots = AssignSlots(Layout, Base);
+    SplitEdges(Layout);
+
+    // The arguments are pushed in order so they are stored in reverse
+    int Entry = CobaluStack.Size();
+    for (int i=Func.Params-1; i >= 0; i--) {
+        EmitInst(varst, i);
+    }
+
+    std::vector<int> Start(Func.Blocks.size());
+    std::vector<std::pair<int, int>> Jumps; // place and block, -1 the end
+    for (int l=0; l < (int)Layout.size(); l++) {
+        int Block = Layout[l];
+        int Next = l + 1 < (int)Layout.size() ? Layout[l + 1] : -1;
+        Start[Block] = CobaluStack.Size();
+
+        for (int Val : Code[Block]) {
+            IrInst& Inst = Func.Values[Val];
+            if (Tree[Val]) {
+                continue;
+            }
+            const std::vector<int>& Succs = Func.Blocks[Block].Succs;
+
+            switch (Inst.Op) {
+                case ijmp: {
+                    EmitCopies(Copies(Block));
+                    if (Succs[0] != Next) {
+                        Jumps.push_back({EmitJump(jmp), Succs[0]});
+                    }
+                    break;
+                }
+                case ibranch: {
+                    // The condition stays on the stack under the copies
+                    PushValue(Inst.Args[0]);
+                    EmitCopies(Copies(Block));
+                    if (Succs[1] == Next) {
+                        Jumps.push_back({EmitJump(jmpt), Succs[0]});
+                    } else {
+                        Jumps.push_back({EmitJump(jmpf), Succs[1]});
+                        if (Succs[0] != Next) {
+                            Jumps.push_back({EmitJump(jmp), Succs[0]});
+                        }
+                    }
+                    break;
+                }
+                case iret: {
+                    // A call that is only returned reuses the frame
+                    IrInst& Call = Func.Values[Inst.Args[0]];
+                    if (Call.Op == icall && Tree[Inst.Args[0]]) {
+                        for (int Arg : Call.Args) {
+                            PushValue(Arg);
+                        }
+                        EmitInst(tailcall, Call.Imm);
+                        break;
+                    }
+                    PushValue(Inst.Args[0]);
+                    EmitInst(retrn);
+                    break;
+                }
+                case iend: {
+                    if (Func.Index != -1) {
+                        EmitInst(funcend);
+                    } else if (Next != -1) {
+                        Jumps.push_back({EmitJump(jmp), -1});
+                    }
+                    break;
+                }
+                default: {
+                    Compute(Val);
+                    if (Produces(Inst.Op)) {
+                        if (Uses[Val]) {
+                            StoreSlot(Val);
+                        } else {
+                            EmitInst(pop);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    for (auto& [Jump, Block] : Jumps) {
+        PatchJump(Jump, Block == -1 ? CobaluStack.Size() : Start[Block]);
+    }
+    if (Func.Index != -1) {
+        CobaluStack.SetFunc(Func.Index, Entry, Slots);
+    }
+    return Slots;
+}
+
+#ifdef DEBUG
+void SsaDump(IrFunction& Func) {
+    const char* Names[] = {"const", "param", "load", "store", "phi", "binary",
+                           "unary", "print", "call", "jmp", "branch", "ret",
+                           "end"};
+    fprintf(stderr, "function %d\n", Func.Index);
+    for (int b=0; b < Func.Blocks.size(); b++) {
+        IrBlock& Block = Func.Blocks[b];
+        if (!Block.Reachable) {
+            continue;
+        }
+        fprintf(stderr, "block %d preds", b);
+        for (int Pred : Block.Preds) {
+            fprintf(stderr, " %d", Pred);
+        }
+        fprintf(stderr, "\n");
+        std::vector<int> Insts = Block.Phis;
+        Insts.insert(Insts.end(), Block.Insts.begin(), Block.Insts.end());
+        for (int Val : Insts) {
+            IrInst& Inst = Func.Values[Val];
+            if (Inst.Dead) {
+                continue;
+            }
+            fprintf(stderr, "  v%d = %s %d type %d", Val, Names[Inst.Op],
+                    Inst.Imm, Inst.Type);
+            for (int Arg : Inst.Args) {
+                fprintf(stderr, " v%d", Arg);
+            }
+            fprintf(stderr, "\n");
+        }
+    }
+}
+#endif
@@ -0,0 +1,97 @@
+#include "Headers/exec.h"
+#include "Headers/value.h"
+
+// +++++++++++++++++
+// ++++ GLOBALS ++++
+// +++++++++++++++++
+
+// Table of interned strings, the key points to the text of the object
+std::unordered_map<std::string_view, StrObj*> StringTable;
+
+// Bytes of strings created during the execution that are still alive
+long HeapUsed = 0;
+
+// Symbol of the next string interned
+uint32_t NextSymbol = 1;
+
+///////////////////////////////////////////////////////////////////////////////
+////////////                    STRING HEAP                        ////////////
+///////////////////////////////////////////////////////////////////////////////
+
+// FNV-1a
+uint32_t HashString(const char* Text, uint32_t Length) {
+    uint32_t Hash = 2166136261u;
+    for (uint32_t i=0; i < Length; i++) {
+        Hash ^= (uint8_t)Text[i];
+        Hash *= 16777619;
+    }
+    return Hash;
+}
+
+// Allocates the object with room for the text, it still needs to be filled
+StrObj* AllocString(uint32_t Length) {
+    StrObj* Str = (StrObj*)malloc(sizeof(StrObj) + Length + 1);
+    Str->RefCount = 0;
+    Str->Length = Length;
+    Str->Symbol = 0;
+    Str->Text[Length] = '\0';
+    return Str;
+}
+
+// Returns the interned string of the text, creating it if needed
+StrObj* Intern(std::string_view Text) {
+    auto Found = StringTable.find(Text);
+    if (Found != StringTable.end()) {
+        return Found->second;
+    }
+
+    StrObj* Str = AllocString(Text.size());
+    memcpy(Str->Text, Text.data(), Text.size());
+    Str->Hash = HashString(Str->Text, Str->Length);
+    Str->Symbol = NextSymbol++;
+    // The reference of the table keeps the string alive
+    Str->RefCount = 1;
+
+    StringTable[Str->View()] = Str;
+    return Str;
+}
+
+// Creates a string during the execution, every new string counts on the heap
+StrObj* ConcatString(const StrObj* Left, const StrObj* Right) {
+    uint32_t Length = Left->Length + Right->Length;
+
+    HeapUsed += sizeof(StrObj) + Length + 1;
+    if (HeapUsed > CobaluOpts.HeapLimit) {
+        LimitError("heap exhausted, the limit in bytes is",
+                   CobaluOpts.HeapLimit);
+    }
+
+    StrObj* Str = AllocString(Length);
+    memcpy(Str->Text, Left->Text, Left->Length);
+    memcpy(Str->Text + Left->Length, Right->Text, Right->Length);
+    Str->Hash = HashString(Str->Text, Length);
+    return Str;
+}
+
+// Interned strings are unique, two of them are equal only if they are the 
+// same object
+bool EqualStrings(const StrObj* Left, const StrObj* Right) {
+    if (Left == Right) {
+        return true;
+    }
+    if (Left->Symbol && Right->Symbol) {
+        return false;
+    }
+    return Left->Hash == Right->Hash && Left->Length == Right->Length &&
+           memcmp(Left->Text, Right->Text, Left->Length) == 0;
+}
+
+// Called when the last reference to the string is gone
+void FreeString(StrObj* Str) {
+    HeapUsed -= sizeof(StrObj) + Str->Length + 1;
+    free(Str);
+}
+
+long HeapSize() {
+    return HeapUsed;
+}
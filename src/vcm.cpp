@@ -1,6 +1,9 @@
 #include "Headers/error_log.h"
 #include "Headers/exec.h"
 #include "Headers/vcm.h" 
+#include "Headers/regvm.h"
+#include "Headers/dispatch.h"
+#include <functional>
 
 // +++++++++++++++++
 // ++++ GLOBALS ++++
@@ -12,7 +15,6 @@ Calculus ExecStack;
 // Stack of instructions
 InstructionStack CobaluStack;
 
-#ifdef DEBUG
 // Map of Instructions to String
 std::unordered_map<Instruction, std::string> inst_to_str = { 
     {ndoubl, "ndoubl"},
@@ -20,7 +22,9 @@ std::unordered_map<Instruction, std::string> inst_to_str = {
     {bolen, "bolen"},
     {none, "none"},
     {varst, "varst"},
-    {varrt, "vart"},
+    {varrt, "varrt"},
+    {glbst, "glbst"},
+    {glbrt, "glbrt"},
     {addD, "addD"},
     {subD, "subD"},
     {divD, "divD"},
@@ -34,33 +38,44 @@ std::unordered_map<Instruction, std::string> inst_to_str = {
     {negte, "negte"},
     {invsig, "invsig"},
     {stio, "stio"},
-    {setto, "setto"},
+    {pop, "pop"},
+    {jmp, "jmp"},
+    {jmpf, "jmpf"},
+    {jmpt, "jmpt"},
     {funcsta, "funcsta"},
     {funcend, "funcend"},
     {callfunc, "callfunc"},
     {endstk, "endstk"},
     {retrn, "retrn"},
+    {tailcall, "tailcall"},
     {stop, "stop"},
-};
-#endif
-
-// Map of Instructions to Methods
-typedef void (Calculus::*calc_method)();
-std::unordered_map<Instruction, calc_method> inst_to_func = {
-    {addD, &Calculus::addData},
-    {subD, &Calculus::subData},
-    {divD, &Calculus::divData},
-    {mulD, &Calculus::mulData},
-    {eqD, &Calculus::eqData},
-    {ineqD, &Calculus::ineqData},
-    {grD, &Calculus::grData},
-    {lsD, &Calculus::lsData},
-    {greqD, &Calculus::greqData},
-    {lseqD, &Calculus::lseqData},
-    {negte, &Calculus::negData},
-    {invsig, &Calculus::invsigData},
-    {stio, &Calculus::printData},
-    {setto, &Calculus::evalCondition},
+    {glbcmp, "glbcmp"},
+    {varcmp, "varcmp"},
+    {glbarith, "glbarith"},
+    {vararith, "vararith"},
+    {addnum, "addnum"},
+    {addstr, "addstr"},
+    {subnum, "subnum"},
+    {mulnum, "mulnum"},
+    {divnum, "divnum"},
+    {eqnum, "eqnum"},
+    {eqstr, "eqstr"},
+    {ineqnum, "ineqnum"},
+    {ineqstr, "ineqstr"},
+    {grnum, "grnum"},
+    {lsnum, "lsnum"},
+    {greqnum, "greqnum"},
+    {lseqnum, "lseqnum"},
+    {addN, "addN"},
+    {subN, "subN"},
+    {mulN, "mulN"},
+    {divN, "divN"},
+    {eqN, "eqN"},
+    {ineqN, "ineqN"},
+    {grN, "grN"},
+    {lsN, "lsN"},
+    {greqN, "greqN"},
+    {lseqN, "lseqN"},
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -84,33 +99,87 @@ int InstructionStack::EOS() {
     return eos;
 }
 
-void InstructionStack::SetRet(int flag) {
-   ret = flag;
-}
-
-int InstructionStack::RET() {
-    return ret;
-}
-
-void InstructionStack::ChangeValue(Value data, int offset) {
-    Bytecode byte = Stack[offset];
-    byte.data = data;
-    Stack[byte.offset] = byte;
-    return;
-}
-
 void InstructionStack::Insert(Bytecode byte, int offset) {
     Stack[offset] = byte;
     return;
 }
 
-Bytecode InstructionStack::Return(int offset = -1) {
+// Raw view of the stack, invalidated whenever the stack grows
+Bytecode* InstructionStack::Code() {
+    return Stack.data();
+}
+
+const Bytecode& InstructionStack::Return(int offset = -1) {
     if (offset == -1) {
         return Stack[sp];
     }
     return Stack[offset];
 }
 
+// Replaces the instructions by a rewrite of them. Moved has the new place of
+// each old instruction, the entries of the functions follow it
+void InstructionStack::Replace(std::vector<Bytecode> Code, 
+                               const std::vector<int>& Moved) {
+    Stack = std::move(Code);
+    for (Function& func : Functions) {
+        func.Entry = Moved[func.Entry];
+    }
+}
+
+// Insert a constant in the pool, equal constants share the same index
+int InstructionStack::AddConst(Value imm) {
+    // Compare the bits so 0 and -0 don't end up in the same slot
+    uint64_t bits = imm.Raw();
+    if (NumPool.count(bits)) {
+        return NumPool[bits];
+    }
+    NumPool[bits] = Constants.size();
+    Constants.push_back(imm);
+    return Constants.size() - 1;
+}
+
+// Strings of the pool are interned
+int InstructionStack::AddConst(StrObj* text) {
+    if (StrPool.count(text)) {
+        return StrPool[text];
+    }
+    StrPool[text] = Constants.size();
+    Constants.push_back(text);
+    return Constants.size() - 1;
+}
+
+const Value& InstructionStack::Const(int index) {
+    return Constants[index];
+}
+
+// Raw view of the pool, invalidated whenever a constant is added
+const Value* InstructionStack::Pool() {
+    return Constants.data();
+}
+
+// Reserves a index on the table of functions
+int InstructionStack::AddFunc() {
+    Functions.push_back({0, 0});
+    return Functions.size() - 1;
+}
+
+void InstructionStack::SetFunc(int index, int entry, int locals) {
+    Functions[index].Entry = entry;
+    Functions[index].Locals = locals;
+}
+
+const Function& InstructionStack::Func(int index) {
+    return Functions[index];
+}
+
+void InstructionStack::SetGlobals(int size) {
+    globals = size;
+}
+
+int InstructionStack::Globals() {
+    return globals;
+}
+
 void InstructionStack::Advance() {
     sp++;
     if (sp > Stack.size()) {
@@ -130,15 +199,28 @@ void InstructionStack::Goto(int offset) {
 
 void InstructionStack::SetBreaks(int Start, int End) {
     for (;Start < End; Start++) {
-        if (Stack[Start].inst == setto) {
-            if (std::get<double>(Stack[Start].data) == -1) {
-                Stack[Start].data = 0.0;
-                Stack[Start].offset = -(Stack[Start].offset - End);
-            }
+        if (Stack[Start].inst == jmp && Stack[Start].offset == BREAKPOINT) {
+            Stack[Start].offset = End - Start;
         }
     }
 }
 
+// Marks the instructions where a jump, a call or the skip of a function 
+// lands, the execution can reach them without passing by the previous one
+std::vector<bool> InstructionStack::Landings() {
+    std::vector<bool> Marks(Stack.size() + 1);
+    for (int i=0; i < (int)Stack.size(); i++) {
+        if (Stack[i].inst == jmp || Stack[i].inst == jmpf ||
+            Stack[i].inst == jmpt || Stack[i].inst == funcsta) {
+            Marks[i + Stack[i].offset + 1] = true;
+        }
+    }
+    for (const Function& func : Functions) {
+        Marks[func.Entry] = true;
+    }
+    return Marks;
+}
+
 #ifdef DEBUG
 void InstructionStack::StackReset() {
     sp = 0;
@@ -150,77 +232,406 @@ void InstructionStack::StackReset() {
 ////////////                    VM EXECUTION                       ////////////
 ///////////////////////////////////////////////////////////////////////////////
 
-void Interpreter(Bytecode byte, int offset) {
+#ifdef COUNT_DISPATCH
+long long Dispatches = 0;
+#endif
+
+// Times each instruction was executed, only when profiling
+std::vector<long long> Hits;
+
+// Operands of the superinstructions, the words of the sequence keep its
+// original instructions
+const Value& Loaded(const Bytecode& byte) {
     switch (byte.inst) {
-        case ndoubl:
-        case bolen:
-        case cstr:
-        case none: {
-            ExecStack.PushCalc(byte.data);
-            break;
-        }
-        case addD:
-        case subD:
-        case mulD:
-        case divD:
-        case eqD:
-        case ineqD:
-        case grD:
-        case lsD:
-        case greqD:
-        case lseqD:
-        case negte:
-        case invsig:
-        case stio:
-        case setto: {
-            // Cool Hack to call methods that don't need args
-            calc_method method = inst_to_func[byte.inst];
-            (ExecStack.*method)();
-            break;
-        } 
-        case varst: {
-           ExecStack.stvarData(offset);
-           break;
+        case glbrt: return ExecStack.Global(byte.offset);
+        case varrt: return ExecStack.Local(byte.offset);
+        default: return CobaluStack.Const(byte.offset);
+    }
+}
+
+Value& Stored(const Bytecode& byte) {
+    if (byte.inst == glbst) {
+        return ExecStack.Global(byte.offset);
+    }
+    return ExecStack.Local(byte.offset);
+}
+
+// The words of a superinstruction may be quickened when it falls back
+bool Compare(Instruction inst, double Left, double Right) {
+    switch (inst) {
+        case eqD: case eqnum: case eqstr: case eqN: return Left == Right;
+        case ineqD: case ineqnum: case ineqstr: case ineqN: 
+            return Left != Right;
+        case grD: case grnum: case grN: return Left > Right;
+        case lsD: case lsnum: case lsN: return Left < Right;
+        case greqD: case greqnum: case greqN: return Left >= Right;
+        default: return Left <= Right;
+    }
+}
+
+double Arith(Instruction inst, double Left, double Right) {
+    switch (inst) {
+        case addD: case addnum: case addstr: case addN: return Left + Right;
+        case subD: case subnum: case subN: return Left - Right;
+        case mulD: case mulnum: case mulN: return Left * Right;
+        default: return Left / Right;
+    }
+}
+
+// Variant of the operation for the types of its operands
+Instruction Specialize(Instruction inst, const Value& Left, 
+                       const Value& Right) {
+    bool Num = Left.IsDouble() && Right.IsDouble();
+    bool Str = Left.IsString() && Right.IsString();
+    switch (inst) {
+        case addD: return Num ? addnum : Str ? addstr : inst;
+        case subD: return Num ? subnum : inst;
+        case mulD: return Num ? mulnum : inst;
+        case divD: return Num ? divnum : inst;
+        case eqD: return Num ? eqnum : Str ? eqstr : inst;
+        case ineqD: return Num ? ineqnum : Str ? ineqstr : inst;
+        case grD: return Num ? grnum : inst;
+        case lsD: return Num ? lsnum : inst;
+        case greqD: return Num ? greqnum : inst;
+        default: return Num ? lseqnum : inst;
+    }
+}
+
+// The first time a generic operation runs it is rewritten to the variant for
+// the types on the stack. If there is none, or the site was de-optimized too
+// many times, it stays generic
+void Quicken(Bytecode& byte) {
+    if (byte.offset >= DEOPT_LIMIT) {
+        return;
+    }
+
+    const Value* Right = ExecStack.Peek(0);
+    const Value* Left = ExecStack.Peek(1);
+    if (!Left) {
+        return;
+    }
+
+    byte.inst = Specialize(byte.inst, *Left, *Right);
+    if (byte.inst <= lseqD) {
+        byte.offset = DEOPT_LIMIT;
+    }
+}
+
+// The guard of a quickened operation failed
+long long Deopts = 0;
+void Deopt(Bytecode& byte, Instruction generic) {
+    byte.inst = generic;
+    byte.offset++;
+    Deopts++;
+}
+
+// Typed operation, it has no guard
+#define TYPED(inst, op) CASE(inst) { \
+    ExecStack.typedData(op()); \
+    NEXT(); \
+}
+
+// Quickened operation, the generic one runs when the guard fails
+#define QUICKENED(inst, generic, fast, slow) CASE(inst) { \
+    if (!(fast)) { \
+        Deopt(code[sp], generic); \
+        slow; \
+    } \
+    NEXT(); \
+}
+
+void CodeExec() {
+    #ifdef THREADED_DISPATCH
+    // Must follow the order of the enum Instruction
+    static void* handlers[] = {
+        &&L_ndoubl, &&L_cstr, &&L_bolen, &&L_none,
+        &&L_addD, &&L_subD, &&L_mulD, &&L_divD,
+        &&L_eqD, &&L_ineqD, &&L_grD, &&L_lsD, &&L_greqD, &&L_lseqD,
+        &&L_negte, &&L_invsig,
+        &&L_stio, &&L_pop,
+        &&L_varst, &&L_varrt, &&L_glbst, &&L_glbrt,
+        &&L_funcsta, &&L_funcend, &&L_stop, &&L_callfunc, &&L_retrn,
+        &&L_tailcall,
+        &&L_jmp, &&L_jmpf, &&L_jmpt,
+        &&L_glbcmp, &&L_varcmp, &&L_glbarith, &&L_vararith,
+        &&L_addnum, &&L_addstr, &&L_subnum, &&L_mulnum, &&L_divnum,
+        &&L_eqnum, &&L_eqstr, &&L_ineqnum, &&L_ineqstr,
+        &&L_grnum, &&L_lsnum, &&L_greqnum, &&L_lseqnum,
+        &&L_addN, &&L_subN, &&L_mulN, &&L_divN,
+        &&L_eqN, &&L_ineqN, &&L_grN, &&L_lsN, &&L_greqN, &&L_lseqN,
+        &&L_endstk,
+    };
+    static_assert(sizeof(handlers)/sizeof(handlers[0]) == endstk + 1,
+                  "handlers out of sync with Instruction");
+
+    // When profiling every instruction goes through the counter first
+    void* profiled[endstk + 1];
+    for (void*& label : profiled) {
+        label = &&L_profile;
+    }
+    void** labels = CobaluOpts.Profile ? profiled : handlers;
+    #endif
+
+    Bytecode* code = CobaluStack.Code();
+    int sp = CobaluStack.SP();
+    long long* hits = Hits.data();
+
+    #ifdef THREADED_DISPATCH
+    DISPATCH();
+    #else
+    while (true) {
+    if (CobaluOpts.Profile) {
+        hits[sp]++;
+    }
+    switch (code[sp].inst) {
+    #endif
+
+    #ifdef THREADED_DISPATCH
+    L_profile: {
+        hits[sp]++;
+        goto *handlers[code[sp].inst];
+    }
+    #endif
+
+    CASE(ndoubl)
+    CASE(cstr) {
+        ExecStack.PushCalc(CobaluStack.Const(code[sp].offset));
+        NEXT();
+    }
+    CASE(bolen) {
+        ExecStack.PushCalc((bool)code[sp].offset);
+        NEXT();
+    }
+    CASE(none) {
+        ExecStack.PushCalc(nullptr);
+        NEXT();
+    }
+    CASE(addD) {
+        Quicken(code[sp]);
+        ExecStack.addData();
+        NEXT();
+    }
+    CASE(subD) {
+        Quicken(code[sp]);
+        ExecStack.subData();
+        NEXT();
+    }
+    CASE(mulD) {
+        Quicken(code[sp]);
+        ExecStack.mulData();
+        NEXT();
+    }
+    CASE(divD) {
+        Quicken(code[sp]);
+        ExecStack.divData();
+        NEXT();
+    }
+    CASE(eqD) {
+        Quicken(code[sp]);
+        ExecStack.eqData();
+        NEXT();
+    }
+    CASE(ineqD) {
+        Quicken(code[sp]);
+        ExecStack.ineqData();
+        NEXT();
+    }
+    CASE(grD) {
+        Quicken(code[sp]);
+        ExecStack.grData();
+        NEXT();
+    }
+    CASE(lsD) {
+        Quicken(code[sp]);
+        ExecStack.lsData();
+        NEXT();
+    }
+    CASE(greqD) {
+        Quicken(code[sp]);
+        ExecStack.greqData();
+        NEXT();
+    }
+    CASE(lseqD) {
+        Quicken(code[sp]);
+        ExecStack.lseqData();
+        NEXT();
+    }
+    CASE(negte) {
+        ExecStack.negData();
+        NEXT();
+    }
+    CASE(invsig) {
+        ExecStack.invsigData();
+        NEXT();
+    }
+    CASE(stio) {
+        ExecStack.printData();
+        NEXT();
+    }
+    CASE(pop) {
+        ExecStack.popData();
+        NEXT();
+    }
+    CASE(varst) {
+        ExecStack.stvarData(code[sp].offset);
+        NEXT();
+    }
+    CASE(varrt) {
+        ExecStack.retvarData(code[sp].offset);
+        NEXT();
+    }
+    CASE(glbst) {
+        ExecStack.stglobData(code[sp].offset);
+        NEXT();
+    }
+    CASE(glbrt) {
+        ExecStack.retglobData(code[sp].offset);
+        NEXT();
+    }
+    CASE(funcsta) {
+        // The body only runs when called, jump over the funcend
+        sp += code[sp].offset;
+        NEXT();
+    }
+    CASE(stop) {
+        NEXT();
+    }
+    CASE(callfunc) {
+        sp = ExecStack.callFunc(code[sp].offset, sp + 1);
+        DISPATCH();
+    }
+    CASE(jmp) {
+        sp += code[sp].offset;
+        NEXT();
+    }
+    CASE(jmpf) {
+        if (ExecStack.evalCondition()) {
+            sp += code[sp].offset;
         }
-        case varrt: {
-            ExecStack.retvarData(offset);
-            break;
+        NEXT();
+    }
+    CASE(jmpt) {
+        if (!ExecStack.evalCondition()) {
+            sp += code[sp].offset;
         }
-        case funcsta: {
-            ExecStack.funcGen(offset);
-            break;
+        NEXT();
+    }
+    // The superinstructions only handle doubles, anything else runs the 
+    // first instruction and continues on the words of the sequence
+    CASE(glbcmp) {
+        const Value& Left = ExecStack.Global(code[sp].offset);
+        const Value& Right = Loaded(code[sp + 1]);
+        if (!Left.IsDouble() || !Right.IsDouble()) {
+            ExecStack.retglobData(code[sp].offset);
+            NEXT();
         }
-        case callfunc: {
-            ExecStack.callFunc(offset);
-            break;
+        // Jumps like the jmpf or the jmpt that closes the sequence
+        bool Cond = Compare(code[sp + 2].inst, Left.AsDouble(), 
+                            Right.AsDouble());
+        sp += Cond == (code[sp + 3].inst == jmpt) ? 4 + code[sp + 3].offset
+                                                  : 4;
+        DISPATCH();
+    }
+    CASE(varcmp) {
+        const Value& Left = ExecStack.Local(code[sp].offset);
+        const Value& Right = Loaded(code[sp + 1]);
+        if (!Left.IsDouble() || !Right.IsDouble()) {
+            ExecStack.retvarData(code[sp].offset);
+            NEXT();
         }
-        case retrn:
-            ExecStack.retfuncData(offset);
-        case stop: {
-            break;
+        bool Cond = Compare(code[sp + 2].inst, Left.AsDouble(), 
+                            Right.AsDouble());
+        sp += Cond == (code[sp + 3].inst == jmpt) ? 4 + code[sp + 3].offset
+                                                  : 4;
+        DISPATCH();
+    }
+    CASE(glbarith) {
+        const Value& Left = ExecStack.Global(code[sp].offset);
+        const Value& Right = Loaded(code[sp + 1]);
+        if (!Left.IsDouble() || !Right.IsDouble()) {
+            ExecStack.retglobData(code[sp].offset);
+            NEXT();
         }
-        default: {
-            ErLogs.PushError("", "Instuction was not reconized", 2);
-            break; // the show must go on
+        Stored(code[sp + 3]) = Arith(code[sp + 2].inst, Left.AsDouble(),
+                                     Right.AsDouble());
+        sp += 4;
+        DISPATCH();
+    }
+    CASE(vararith) {
+        const Value& Left = ExecStack.Local(code[sp].offset);
+        const Value& Right = Loaded(code[sp + 1]);
+        if (!Left.IsDouble() || !Right.IsDouble()) {
+            ExecStack.retvarData(code[sp].offset);
+            NEXT();
         }
+        Stored(code[sp + 3]) = Arith(code[sp + 2].inst, Left.AsDouble(),
+                                     Right.AsDouble());
+        sp += 4;
+        DISPATCH();
+    }
+    QUICKENED(addnum, addD, ExecStack.numData(std::plus<double>()), 
+              ExecStack.addData())
+    QUICKENED(addstr, addD, ExecStack.addstrData(), ExecStack.addData())
+    QUICKENED(subnum, subD, ExecStack.numData(std::minus<double>()), 
+              ExecStack.subData())
+    QUICKENED(mulnum, mulD, ExecStack.numData(std::multiplies<double>()),
+              ExecStack.mulData())
+    QUICKENED(divnum, divD, ExecStack.numData(std::divides<double>()),
+              ExecStack.divData())
+    QUICKENED(eqnum, eqD, ExecStack.numData(std::equal_to<double>()),
+              ExecStack.eqData())
+    QUICKENED(eqstr, eqD, ExecStack.eqstrData(true), ExecStack.eqData())
+    QUICKENED(ineqnum, ineqD, ExecStack.numData(std::not_equal_to<double>()),
+              ExecStack.ineqData())
+    QUICKENED(ineqstr, ineqD, ExecStack.eqstrData(false), 
+              ExecStack.ineqData())
+    QUICKENED(grnum, grD, ExecStack.numData(std::greater<double>()),
+              ExecStack.grData())
+    QUICKENED(lsnum, lsD, ExecStack.numData(std::less<double>()),
+              ExecStack.lsData())
+    QUICKENED(greqnum, greqD, ExecStack.numData(std::greater_equal<double>()),
+              ExecStack.greqData())
+    QUICKENED(lseqnum, lseqD, ExecStack.numData(std::less_equal<double>()),
+              ExecStack.lseqData())
+    TYPED(addN, std::plus<double>)
+    TYPED(subN, std::minus<double>)
+    TYPED(mulN, std::multiplies<double>)
+    TYPED(divN, std::divides<double>)
+    TYPED(eqN, std::equal_to<double>)
+    TYPED(ineqN, std::not_equal_to<double>)
+    TYPED(grN, std::greater<double>)
+    TYPED(lsN, std::less<double>)
+    TYPED(greqN, std::greater_equal<double>)
+    TYPED(lseqN, std::less_equal<double>)
+    CASE(funcend) {
+        // Function without return gives a null
+        ExecStack.PushCalc(nullptr);
+        sp = ExecStack.retfuncData();
+        DISPATCH();
+    }
+    CASE(retrn) {
+        sp = ExecStack.retfuncData();
+        DISPATCH();
+    }
+    CASE(tailcall) {
+        sp = ExecStack.tailFunc(code[sp].offset);
+        DISPATCH();
+    }
+    CASE(endstk) {
+        goto exit;
     }
-}
-
-void CodeExec(int EOS) {
-    // Execute instruction line by line
-    while (true) {
-        if (CobaluStack.SP() != EOS && !CobaluStack.RET()) {
-            Interpreter(CobaluStack.Return(), CobaluStack.SP());
-            CobaluStack.Advance();
 
-            if (CobaluStack.Size() >= 80) {
-                break;
-            }
-        } else {
-            CobaluStack.SetRet(0);
-            break;
-        }
+    #ifndef THREADED_DISPATCH
+    default: {
+        ErLogs.PushError("", "Instuction was not reconized", 2);
+        NEXT(); // the show must go on
+    }
+    }
     }
+    #endif
+
+exit:
+    CobaluStack.Goto(sp);
 
     // If there is any error show all of them
     if (ErLogs.NumErrors()) {
@@ -230,16 +641,45 @@ void CodeExec(int EOS) {
 }
 
 void InitVM() {
-    // Generate the code and fill the stack
-    Compile();
+    if (CobaluOpts.Register) {
+        // Generate the code of the register machine and run it
+        RegCompile();
+        RegExec();
+    } else {
+        // Generate the code and fill the stack
+        if (CobaluOpts.Ssa) {
+            SsaCompile();
+        } else {
+            Compile();
+        }
 
-    // Set the End of Stack
-    Bytecode byte;
-    byte.inst = endstk;
-    CobaluStack.Push(byte);
-    CobaluStack.SetEOS();
+        // Set the End of Stack
+        Bytecode byte;
+        byte.inst = endstk;
+        CobaluStack.Push(byte);
 
-    CodeExec(CobaluStack.Size() - 1);
+        if (CobaluOpts.Optimize) {
+            PeepholeOptimize();
+        }
+        CobaluStack.SetEOS();
+
+        if (CobaluOpts.Fuse) {
+            FuseInstructions();
+        }
+        if (CobaluOpts.Profile) {
+            Hits.resize(CobaluStack.Size());
+        }
+
+        ExecStack.InitGlobals(CobaluStack.Globals());
+        CodeExec();
+
+        if (CobaluOpts.Profile) {
+            ProfileReport();
+        }
+    }
+    #ifdef COUNT_DISPATCH
+    std::cerr << "dispatches: " << Dispatches << std::endl;
+    #endif
     #ifdef DEBUG
         std::cout << std::left << std::setw(30) << "================ COBALU STACK ================" << std::endl;
         std::cout << std::left << std::setw(6) << "x" << "|";
@@ -250,28 +690,27 @@ void InitVM() {
         while (CobaluStack.SP() < CobaluStack.Size()) {
             Bytecode byte = CobaluStack.Return();
             std::cout << std::left << std::setw(6) << CobaluStack.SP() << "|";
-            switch(byte.data.index()) {
-            case doub: {
+            switch(byte.inst) {
+            case ndoubl: {
                 std::cout << std::left << std::setw(20) <<
-                    std::get<double>(byte.data);
+                    CobaluStack.Const(byte.offset).AsDouble();
                 break;
             }
-            case str: {
+            case cstr: {
                 std::cout << std::left << std::setw(20) <<
-                    std::get<std::string>(byte.data);
+                    CobaluStack.Const(byte.offset).AsString()->Text;
                 break;
             }
-            case boo: {
-                std::cout << std::left << std::setw(20) <<
-                    std::get<bool>(byte.data);
+            case bolen: {
+                std::cout << std::left << std::setw(20) << (bool)byte.offset;
                 break;
             }
-            case nil: {
+            case none: {
                 std::cout << std::left << std::setw(20) << "null";
                 break;
             }
             default: {
-                    std::cout << std::left << std::setw(20) << "[ERROR]";
+                    std::cout << std::left << std::setw(20) << "";
                     break;
                 }
             }